@@ -0,0 +1,52 @@
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "partialDifferential.h"
+
+#define CHECKPOINT_MAGIC "PDECKP2"  // First bytes of the checkpoint files (version 2, with nz).
+
+// Solver state saved with each snapshot of "x".
+typedef struct checkpointState {
+    int32_t it;      // Sweeps done.
+    int32_t nNorms;  // Residual evaluations done.
+    double omega;    // Relaxation factor in use.
+    double sqrMu;    // Estimate of the adaptive SOR.
+} checkpointState;
+
+// Open checkpoint file. The file holds the residual history and two snapshot slots, written alternately so a snapshot
+// interrupted half way never overwrites the last complete one. Until its first snapshot is complete the file has a
+// temporary name, so a file with the final name (possibly the one the run restarted from) stays valid. The snapshots
+// are copied to a staging buffer and written to the file by a helper thread.
+typedef struct checkpoint {
+    char *map;       // Mapping of the whole file.
+    size_t size;     // Size of the file.
+    int nx, ny;      // Number of points.
+    int maxNorms;    // Capacity of the residual history.
+    int slot;        // Slot of the last complete snapshot (-1 if none).
+    char *fileName;  // Final name of the file.
+    char *tempName;  // Name of the file until its first snapshot is complete (NULL afterwards).
+    checkpointState state;  // Solver state of the staged snapshot.
+    real_t *norms;          // Residual norms of the staged snapshot (maxNorms).
+    int32_t *its;           // Iterations of those norms (maxNorms).
+    real_t *x;              // Solution of the staged snapshot (nx * ny).
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int pending;   // The staged snapshot was not written yet.
+    int quit;      // The writer thread must exit once the staged snapshot is written.
+    int threaded;  // The writer thread is running (otherwise saveCheckpoint() writes the snapshot itself).
+} checkpoint;
+
+int createCheckpoint(checkpoint *ckpt, const char *fileName, int nx, int ny, int nz, int maxNorms);
+
+void saveCheckpoint(checkpoint *ckpt, const real_t *x, const checkpointState *state, const real_t *arrayL2Norm, const int *arrayIt);
+
+void closeCheckpoint(checkpoint *ckpt);
+
+int loadCheckpoint(const char *fileName, int nx, int ny, int nz, int maxIt, real_t *x, checkpointState *state, real_t **arrayL2Norm, int **arrayIt);
+
+#endif  // __CHECKPOINT_H__
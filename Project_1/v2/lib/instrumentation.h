@@ -0,0 +1,30 @@
+#ifndef __INSTRUMENTATION_H__
+#define __INSTRUMENTATION_H__
+
+// Backend of the LIKWID_MARKER_* region markers, chosen at build time (INSTRUMENTATION in the Makefile):
+//   LIKWID_PERFMON - LIKWID marker API (needs the LIKWID library and, for most groups, the msr module).
+//   PERF_EVENTS    - Linux perf_event_open counters, read per region and printed to stderr at LIKWID_MARKER_CLOSE.
+//   neither        - the markers compile to nothing.
+#if defined(LIKWID_PERFMON)
+#include <likwid.h>
+#elif defined(PERF_EVENTS)
+#define LIKWID_MARKER_INIT perfMarkerInit()
+#define LIKWID_MARKER_START(region) perfMarkerStart(region)
+#define LIKWID_MARKER_STOP(region) perfMarkerStop(region)
+#define LIKWID_MARKER_CLOSE perfMarkerClose()
+#else
+#define LIKWID_MARKER_INIT
+#define LIKWID_MARKER_START(region)
+#define LIKWID_MARKER_STOP(region)
+#define LIKWID_MARKER_CLOSE
+#endif
+
+void perfMarkerInit(void);
+
+void perfMarkerStart(const char *region);
+
+void perfMarkerStop(const char *region);
+
+void perfMarkerClose(void);
+
+#endif  // __INSTRUMENTATION_H__
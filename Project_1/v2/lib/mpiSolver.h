@@ -0,0 +1,31 @@
+#ifndef __MPI_SOLVER_H__
+#define __MPI_SOLVER_H__
+
+#include <mpi.h>
+#include <stdio.h>
+
+#include "partialDifferential.h"
+
+// Row slab of the grid owned by one MPI rank. The local system is matrix-free with the stencil of the global mesh, and
+// its "x" has one halo row below and one above (local.x[-nx .. -1] and local.x[rows * nx .. (rows + 1) * nx - 1]).
+typedef struct mpiSlab {
+    linearSystem local;  // Rows of the rank (local.ny rows), "b" and "x" point past the lower halo row.
+    int nx, ny;          // Global number of points.
+    int j0;              // First global row of the slab.
+    int rank, size;      // Rank and number of ranks of MPI_COMM_WORLD.
+    int below, above;    // Neighbor ranks (MPI_PROC_NULL on the bottom and upper edges of the mesh).
+} mpiSlab;
+
+mpiSlab initMpiSlab(int nx, int ny, const problem *prob, int hugePages);
+
+void freeMpiSlab(mpiSlab *slab);
+
+real_t mpiL2Norm(mpiSlab *slab);
+
+void mpiRedBlackGaussSeidel(mpiSlab *slab, const solverOptions *opts, FILE *output);
+
+void printMpiMesh(mpiSlab *slab, FILE *output);
+
+int writeMpiMeshBinary(mpiSlab *slab, const char *fileName);
+
+#endif  // __MPI_SOLVER_H__
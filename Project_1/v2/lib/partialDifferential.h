@@ -1,29 +1,161 @@
-#ifndef __PARTIAL_DIFFERENTIAL__
-#define __PARTIAL_DIFFERENTIAL__
-
-typedef double real_t;
-
-typedef struct linearSystem {
-    real_t *ssd;  // Superior superior diagonal.
-    real_t *sd;   // Superior diagonal.
-    real_t *md;   // Main diagonal.
-    real_t *id;   // Inferior diagonal.
-    real_t *iid;  // Inferior inferior diagonal.
-    real_t *b;    // Independent terms.
-    real_t *x;    // Solution.
-    int nx, ny;
-} linearSystem;
-
-linearSystem initLinearSystem(int nx, int ny);
-
-void setLinearSystem(linearSystem *linSys);
-
-void gaussSeidel(linearSystem *linSys, int it, FILE *output);
-
-void printGaussSeidelParameters(real_t avrgTime, real_t *arrayL2Norm, FILE *output, int it);
-
-real_t l2Norm(linearSystem *linSys);
-
-void printMesh(linearSystem *linSys, FILE *output);
-
-#endif  // __PARTIAL_DIFFERENTIAL__
+#ifndef __PARTIAL_DIFFERENTIAL__
+#define __PARTIAL_DIFFERENTIAL__
+
+typedef double real_t;
+
+// Iterative method used by pdeSolver.
+typedef enum solverMethod {
+    GAUSS_SEIDEL,  // Serial lexicographic Gauss Seidel.
+    RED_BLACK,     // Red-black ordered Gauss Seidel (OpenMP).
+    WAVEFRONT,     // Temporally blocked lexicographic Gauss Seidel.
+    MULTIGRID,     // Geometric multigrid with Gauss Seidel smoothing.
+    BICGSTAB,      // BiCGSTAB Krylov method.
+    MIXED_PRECISION,  // Gauss Seidel in float with iterative refinement in double.
+    PIPELINED         // Lexicographic Gauss Seidel with the columns split across a pipeline of threads (OpenMP).
+} solverMethod;
+
+// Multigrid cycle type.
+typedef enum multigridCycle {
+    V_CYCLE,
+    F_CYCLE
+} multigridCycle;
+
+#include <stdint.h>
+
+#define SOR_AUTO_OMEGA 0.0  // Value of solverOptions.omega that asks for the automatic estimate.
+
+// Stopping, residual and relaxation parameters of the iterative methods.
+typedef struct solverOptions {
+    int maxIt;     // Number of max iterations.
+    real_t tol;    // Stops when the L2 norm of the residual falls below it (0 disables).
+    int resEvery;  // The residual is evaluated every resEvery sweeps.
+    int depth;     // Sweeps per pass over memory of the temporally blocked method.
+    real_t omega;  // SOR relaxation factor (1 is Gauss Seidel, SOR_AUTO_OMEGA estimates it).
+    multigridCycle cycle;  // Cycle of the multigrid method.
+    int precondition;      // Gauss Seidel preconditioner of the Krylov method.
+    const char *checkpointFile;  // Snapshots of the solver state are saved to it (NULL disables).
+    int checkpointEvery;         // Sweeps between snapshots.
+    const char *restartFile;     // The solve resumes from this checkpoint (NULL starts from zero).
+    int asyncResidual;           // The residual is evaluated by a helper thread during the next sweeps (gs and pgs only).
+} solverOptions;
+
+// Constant coefficients of the five point stencil (one value per diagonal).
+typedef struct stencil {
+    real_t ssd, sd, md, id, iid;
+} stencil;
+
+struct linearSystem;
+
+// Boundary value problem -kxx u_xx - kyy u_yy + cx u_x + cy u_y + k0 u = f(x, y) on [x0, x1] x [y0, y1], with u given
+// on the four edges. The stencil coefficients follow from the constants, the right-hand side from the functions.
+typedef struct problem {
+    const char *name;
+    real_t x0, x1, y0, y1;  // Domain.
+    real_t kxx, kyy;        // Diffusion coefficients.
+    real_t cx, cy;          // Convection coefficients.
+    real_t k0;              // Reaction coefficient.
+    real_t (*source)(real_t x, real_t y);  // f(x, y).
+    real_t (*bottom)(real_t x);            // u(x, y0).
+    real_t (*top)(real_t x);               // u(x, y1).
+    real_t (*left)(real_t y);              // u(x0, y).
+    real_t (*right)(real_t y);             // u(x1, y).
+    // Right-hand side assembly specialized for this problem (NULL uses the generic one, which calls the functions above).
+    void (*rightHandSide)(const struct linearSystem *linSys, real_t *b, int j0, int rows);
+    // Matrix-free Gauss Seidel update and squared residuals of the interior points in [begin, end), specialized for this
+    // problem (NULL uses the generic ones). They do not round as the generic kernels, see problems.c.
+    void (*sweepStencil)(struct linearSystem *linSys, int begin, int end, real_t omega);
+    real_t (*residualSquaresStencil)(const struct linearSystem *linSys, int begin, int end);
+} problem;
+
+#define MESH_MAGIC "PDEMESH"  // First bytes of the binary mesh files.
+
+// Header of the binary mesh file, followed by the nx * ny values of x (x index fastest) as doubles.
+typedef struct meshHeader {
+    char magic[8];   // MESH_MAGIC.
+    int32_t nx, ny;  // Number of points.
+    double hx, hy;   // Mesh spacing.
+    double x0, y0;   // Origin of the domain.
+} meshHeader;
+
+typedef struct linearSystem {
+    real_t *ssd;  // Superior superior diagonal.
+    real_t *sd;   // Superior diagonal.
+    real_t *md;   // Main diagonal.
+    real_t *id;   // Inferior diagonal.
+    real_t *iid;  // Inferior inferior diagonal.
+    real_t *b;    // Independent terms.
+    real_t *x;    // Solution.
+    stencil coef;    // Stencil coefficients (always set).
+    int matrixFree;  // When set the five diagonal arrays are not allocated (NULL).
+    void *arena;     // Single allocation holding all the arrays above.
+    const problem *prob;  // Problem discretized by the system (the first one of problems.h unless set).
+    int nx, ny;
+    int nz;  // Planes of the 3D system this one is a view of (0 for a 2D system).
+} linearSystem;
+
+// Systems with the same operator and nRhs right-hand sides, swept together.
+typedef struct batchSystem {
+    linearSystem op;  // Operator (its "b" and "x" are not used by the batched methods).
+    int nRhs;         // Number of right-hand sides.
+    real_t *b;        // Right-hand sides, interleaved: value r of grid point k at [k * nRhs + r].
+    real_t *x;        // Solutions, interleaved as "b".
+    real_t *norms;    // L2 norm of the residual of each system at the last check.
+    real_t *zero;     // nRhs zeros, the values of a missing neighbour.
+} batchSystem;
+
+linearSystem initLinearSystem(int nx, int ny, int matrixFree, int hugePages);
+
+void freeLinearSystem(linearSystem *linSys);
+
+void gridSpacing(const linearSystem *linSys, real_t *hx, real_t *hy);
+
+void setStencil(linearSystem *linSys);
+
+void setRightHandSide(const linearSystem *linSys, real_t *b, int j0, int rows);
+
+void setLinearSystem(linearSystem *linSys);
+
+// Function that does nSweeps iterations of a method and returns the L2 norm of the residual after the last one.
+typedef real_t (*sweepFunction)(linearSystem *linSys, const solverOptions *opts, void *data, int nSweeps);
+
+void iterativeSolve(linearSystem *linSys, const solverOptions *opts, FILE *output, sweepFunction sweeps, void *data);
+
+struct timerRegion;
+
+void setChunkTimer(struct timerRegion *timer);
+
+void gaussSeidel(linearSystem *linSys, const solverOptions *opts, FILE *output);
+
+void pipelinedGaussSeidel(linearSystem *linSys, const solverOptions *opts, FILE *output);
+
+void redBlackGaussSeidel(linearSystem *linSys, const solverOptions *opts, FILE *output);
+
+void wavefrontGaussSeidel(linearSystem *linSys, const solverOptions *opts, FILE *output);
+
+void multigridSolver(linearSystem *linSys, const solverOptions *opts, FILE *output);
+
+void bicgstabSolver(linearSystem *linSys, const solverOptions *opts, FILE *output);
+
+void mixedPrecisionGaussSeidel(linearSystem *linSys, const solverOptions *opts, FILE *output);
+
+int sequenceInitialGuess(linearSystem *linSys, const solverOptions *opts, int levels, void (*solver)(linearSystem *, const solverOptions *, FILE *));
+
+batchSystem initBatchSystem(int nx, int ny, int nRhs, int matrixFree, int hugePages);
+
+void freeBatchSystem(batchSystem *batch);
+
+void setBatchRightHandSide(batchSystem *batch, int r, const real_t *b);
+
+void getBatchSolution(const batchSystem *batch, int r, real_t *x);
+
+void batchGaussSeidel(batchSystem *batch, const solverOptions *opts, FILE *output);
+
+void printGaussSeidelParameters(real_t avrgTime, real_t *arrayL2Norm, int *arrayIt, FILE *output, int nNorms);
+
+real_t l2Norm(linearSystem *linSys);
+
+void printMesh(linearSystem *linSys, FILE *output);
+
+int writeMeshBinary(linearSystem *linSys, const char *fileName);
+
+#endif  // __PARTIAL_DIFFERENTIAL__
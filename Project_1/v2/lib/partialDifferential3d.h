@@ -0,0 +1,46 @@
+#ifndef __PARTIAL_DIFFERENTIAL_3D__
+#define __PARTIAL_DIFFERENTIAL_3D__
+
+// Boundary value problem -kxx u_xx - kyy u_yy - kzz u_zz + cx u_x + cy u_y + cz u_z + k0 u = f(x, y, z) on
+// [x0, x1] x [y0, y1] x [z0, z1], with u given on the six faces.
+typedef struct problem3d {
+    const char *name;
+    real_t x0, x1, y0, y1, z0, z1;  // Domain.
+    real_t kxx, kyy, kzz;           // Diffusion coefficients.
+    real_t cx, cy, cz;              // Convection coefficients.
+    real_t k0;                      // Reaction coefficient.
+    real_t (*source)(real_t x, real_t y, real_t z);    // f(x, y, z).
+    real_t (*boundary)(real_t x, real_t y, real_t z);  // u on the faces.
+} problem3d;
+
+// Constant coefficients of the seven point stencil (one value per diagonal).
+typedef struct stencil3d {
+    real_t sssd, ssd, sd, md, id, iid, iiid;  // Neighbors k + nx * ny, k + nx, k + 1, k, k - 1, k - nx, k - nx * ny.
+} stencil3d;
+
+// Matrix-free system of an nx * ny * nz grid. The arrays hold the grid with one halo layer on each face, which stays
+// zero (the boundary values are moved to "b"), so the kernels need no edge tests.
+typedef struct linearSystem3d {
+    real_t *b;  // Independent terms.
+    real_t *x;  // Solution.
+    stencil3d coef;
+    const problem3d *prob;  // Problem discretized by the system (the first one of problems.h unless set).
+    void *arena;            // Single allocation holding "b" and "x".
+    int nx, ny, nz;
+} linearSystem3d;
+
+linearSystem3d initLinearSystem3d(int nx, int ny, int nz, int hugePages);
+
+void freeLinearSystem3d(linearSystem3d *linSys);
+
+void setLinearSystem3d(linearSystem3d *linSys);
+
+real_t l2Norm3d(const linearSystem3d *linSys);
+
+void gaussSeidel3d(linearSystem3d *linSys, const solverOptions *opts, FILE *output);
+
+void redBlackGaussSeidel3d(linearSystem3d *linSys, const solverOptions *opts, FILE *output);
+
+void printMesh3d(const linearSystem3d *linSys, FILE *output);
+
+#endif  // __PARTIAL_DIFFERENTIAL_3D__
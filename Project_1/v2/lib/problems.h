@@ -0,0 +1,15 @@
+#ifndef __PROBLEMS_H__
+#define __PROBLEMS_H__
+
+#define DEFAULT_PROBLEM (&problems[0])        // Problem of the systems that do not set one.
+#define DEFAULT_PROBLEM_3D (&problems3d[0])  // Problem of the 3D systems that do not set one.
+
+extern const problem problems[];
+
+extern const problem3d problems3d[];
+
+const problem *findProblem(const char *name);
+
+const problem3d *findProblem3d(const char *name);
+
+#endif  // __PROBLEMS_H__
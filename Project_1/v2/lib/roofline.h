@@ -0,0 +1,16 @@
+#ifndef __ROOFLINE_H__
+#define __ROOFLINE_H__
+
+// Roofs of the machine measured by the roofline probes.
+typedef struct machinePeaks {
+    double bandwidth;   // STREAM triad bandwidth (GB/s).
+    double flops;       // Multiply-add throughput in double with the instruction set of the SIMD kernels (GFLOP/s).
+    double floatFlops;  // The same in float (GFLOP/s).
+    const char *probe;  // Instructions of the throughput probe.
+} machinePeaks;
+
+machinePeaks measureMachinePeaks(void);
+
+double attainableFlops(const machinePeaks *peaks, double intensity, int singlePrecision);
+
+#endif  // __ROOFLINE_H__
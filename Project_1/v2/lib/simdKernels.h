@@ -0,0 +1,21 @@
+#ifndef __SIMD_KERNELS_H__
+#define __SIMD_KERNELS_H__
+
+#include "partialDifferential.h"
+
+// Stencil kernels with a scalar and hand-vectorized versions, the best one for the CPU is selected by initSimdKernels().
+// The ranges [begin, end) must only contain points whose five neighbours exist (interior rows and, for the stencil
+// versions, interior columns).
+typedef struct simdKernels {
+    const char *name;
+    real_t (*residualSquaresDiagonals)(const linearSystem *linSys, int begin, int end);
+    real_t (*residualSquaresStencil)(const linearSystem *linSys, int begin, int end);
+    void (*stencilProductDiagonals)(const linearSystem *linSys, const real_t *v, real_t *y, int begin, int end);
+    void (*stencilProductStencil)(const linearSystem *linSys, const real_t *v, real_t *y, int begin, int end);
+} simdKernels;
+
+extern simdKernels kernels;
+
+void initSimdKernels(void);
+
+#endif  // __SIMD_KERNELS_H__
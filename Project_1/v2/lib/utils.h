@@ -1,9 +1,27 @@
-#ifndef __UTILS_H__
-#define __UTILS_H__
-
-#include <stdlib.h>
-#include <sys/time.h>
-
-double timestamp(void);
-
-#endif  // __UTILS_H__
+#ifndef __UTILS_H__
+#define __UTILS_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Samples of a named timed region (ms).
+typedef struct timerRegion {
+    const char *name;
+    double *samples;
+    int nSamples, capacity;
+} timerRegion;
+
+double timestamp(void);
+
+timerRegion initTimerRegion(const char *name);
+
+void addTimerSample(timerRegion *region, double time);
+
+int compareDouble(const void *a, const void *b);
+
+void printTimerRegions(const timerRegion *regions, int nRegions, FILE *output);
+
+void freeTimerRegion(timerRegion *region);
+
+#endif  // __UTILS_H__
@@ -0,0 +1,33 @@
+#!/usr/bin/env python3
+"""Reader of the binary meshes written by "pdeSolver -f bin -o <file>".
+
+Layout: "PDEMESH\0", int32 nx, int32 ny, double hx, double hy, double x0, double y0, then nx * ny doubles (x index
+fastest). Point k = j * nx + i is at (x0 + (i + 1) * hx, y0 + (j + 1) * hy).
+
+Command line: prints the "x y value" lines of the text output, e.g. in gnuplot:
+    splot '< python3 readMesh.py arquivo_saida' with points
+Module: nx, ny, hx, hy, x0, y0, values = readMesh('arquivo_saida')
+"""
+import struct
+import sys
+from array import array
+
+HEADER = struct.Struct('<8s2i4d')
+
+
+def readMesh(fileName):
+    with open(fileName, 'rb') as f:
+        magic, nx, ny, hx, hy, x0, y0 = HEADER.unpack(f.read(HEADER.size))
+        if magic.rstrip(b'\0') != b'PDEMESH':
+            raise ValueError('%s is not a pdeSolver binary mesh' % fileName)
+        values = array('d')
+        values.fromfile(f, nx * ny)
+    return nx, ny, hx, hy, x0, y0, values
+
+
+if __name__ == '__main__':
+    nx, ny, hx, hy, x0, y0, values = readMesh(sys.argv[1])
+    out = sys.stdout
+    for j in range(ny):
+        for i in range(nx):
+            out.write('%f %f %f\n' % (x0 + (i + 1) * hx, y0 + (j + 1) * hy, values[j * nx + i]))
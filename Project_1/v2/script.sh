@@ -16,13 +16,22 @@ array=(32 50 64 100 128 200 256 300 400 512 1000 1024 2000 2048 3000)
 # Get the processor topology.
 # likwid-topology -g -c
 
+# The default method fuses the residual with the last sweep, so it has no separate L2 norm region: the Gauss Seidel
+# numbers come from it and the L2 norm numbers from the red-black method, whose residual is a separate l2Norm() call.
+# The metrics are taken from the table of the named region, not from the position of the region in the output.
+export OMP_NUM_THREADS=1
+
+region() {
+    awk -v name="Region $1," 'index($0, "Region ") == 1 { inside = index($0, name) == 1 } inside'
+}
+
 # [L3].
 for nx_ny in ${array[*]}
 do
     printf "%s " $nx_ny >> ./likwidPerformance/L3_Gauss_Seidel_Likwid_Performance.dat
     printf "%s " $nx_ny >> ./likwidPerformance/L3_L2_Norm_Likwid_Performance.dat
-    likwid-perfctr -m -f -g L3 -C 0 ./pdeSolver -nx $nx_ny -ny $nx_ny -i 10 -o arquivo_saida | grep "L3 bandwidth" | head -1 | grep -o -P "[0-9]+\.[0-9]+" >> ./likwidPerformance/L3_Gauss_Seidel_Likwid_Performance.dat
-    likwid-perfctr -m -f -g L3 -C 0 ./pdeSolver -nx $nx_ny -ny $nx_ny -i 10 -o arquivo_saida | grep "L3 bandwidth" | tail -1 | grep -o -P "[0-9]+\.[0-9]+" >> ./likwidPerformance/L3_L2_Norm_Likwid_Performance.dat
+    likwid-perfctr -m -f -g L3 -C 0 ./pdeSolver -nx $nx_ny -ny $nx_ny -i 10 -o arquivo_saida | region Gauss_Seidel_Likwid_Performance | grep "L3 bandwidth" | head -1 | grep -o -P "[0-9]+\.[0-9]+" >> ./likwidPerformance/L3_Gauss_Seidel_Likwid_Performance.dat
+    likwid-perfctr -m -f -g L3 -C 0 ./pdeSolver -m rb -nx $nx_ny -ny $nx_ny -i 10 -o arquivo_saida | region L2_Norm_Likwid_Performance | grep "L3 bandwidth" | head -1 | grep -o -P "[0-9]+\.[0-9]+" >> ./likwidPerformance/L3_L2_Norm_Likwid_Performance.dat
 done
 
 # [L2CACHE].
@@ -30,8 +39,8 @@ for nx_ny in ${array[*]}
 do
     printf "%s " $nx_ny >> ./likwidPerformance/L2_CACHE_Gauss_Seidel_Likwid_Performance.dat
     printf "%s " $nx_ny >> ./likwidPerformance/L2_CACHE_L2_Norm_Likwid_Performance.dat
-    likwid-perfctr -m -f -g L2CACHE -C 0 ./pdeSolver -nx $nx_ny -ny $nx_ny -i 10 -o arquivo_saida | grep "L2 miss ratio" | head -1 | grep -o -P "[0-9]+\.[0-9]+" >> ./likwidPerformance/L2_CACHE_Gauss_Seidel_Likwid_Performance.dat
-    likwid-perfctr -m -f -g L2CACHE -C 0 ./pdeSolver -nx $nx_ny -ny $nx_ny -i 10 -o arquivo_saida | grep "L2 miss ratio" | tail -1 | grep -o -P "[0-9]+\.[0-9]+" >> ./likwidPerformance/L2_CACHE_L2_Norm_Likwid_Performance.dat
+    likwid-perfctr -m -f -g L2CACHE -C 0 ./pdeSolver -nx $nx_ny -ny $nx_ny -i 10 -o arquivo_saida | region Gauss_Seidel_Likwid_Performance | grep "L2 miss ratio" | head -1 | grep -o -P "[0-9]+\.[0-9]+" >> ./likwidPerformance/L2_CACHE_Gauss_Seidel_Likwid_Performance.dat
+    likwid-perfctr -m -f -g L2CACHE -C 0 ./pdeSolver -m rb -nx $nx_ny -ny $nx_ny -i 10 -o arquivo_saida | region L2_Norm_Likwid_Performance | grep "L2 miss ratio" | head -1 | grep -o -P "[0-9]+\.[0-9]+" >> ./likwidPerformance/L2_CACHE_L2_Norm_Likwid_Performance.dat
 done
 
 # [FLOPS_DP].
@@ -39,13 +48,13 @@ for nx_ny in ${array[*]}
 do
     printf "%s " $nx_ny >> ./likwidPerformance/DP_MFLOPs_Gauss_Seidel_Likwid_Performance.dat
     printf "%s " $nx_ny >> ./likwidPerformance/DP_MFLOPs_L2_Norm_Likwid_Performance.dat
-    likwid-perfctr -m -f -g FLOPS_DP -C 0 ./pdeSolver -nx $nx_ny -ny $nx_ny -i 10 -o arquivo_saida  | grep -P "^[^\w]+DP MFLOP" | head -1 | grep -o -P "[0-9]+\.[0-9]+" >> ./likwidPerformance/DP_MFLOPs_Gauss_Seidel_Likwid_Performance.dat
-    likwid-perfctr -m -f -g FLOPS_DP -C 0 ./pdeSolver -nx $nx_ny -ny $nx_ny -i 10 -o arquivo_saida  | grep -P "^[^\w]+DP MFLOP" | tail -1 | grep -o -P "[0-9]+\.[0-9]+" >> ./likwidPerformance/DP_MFLOPs_L2_Norm_Likwid_Performance.dat
+    likwid-perfctr -m -f -g FLOPS_DP -C 0 ./pdeSolver -nx $nx_ny -ny $nx_ny -i 10 -o arquivo_saida | region Gauss_Seidel_Likwid_Performance | grep -P "^[^\w]+DP MFLOP" | head -1 | grep -o -P "[0-9]+\.[0-9]+" >> ./likwidPerformance/DP_MFLOPs_Gauss_Seidel_Likwid_Performance.dat
+    likwid-perfctr -m -f -g FLOPS_DP -C 0 ./pdeSolver -m rb -nx $nx_ny -ny $nx_ny -i 10 -o arquivo_saida | region L2_Norm_Likwid_Performance | grep -P "^[^\w]+DP MFLOP" | head -1 | grep -o -P "[0-9]+\.[0-9]+" >> ./likwidPerformance/DP_MFLOPs_L2_Norm_Likwid_Performance.dat
 
     printf "%s " $nx_ny >> ./likwidPerformance/AVX_DP_MFLOPs_Gauss_Seidel_Likwid_Performance.dat
     printf "%s " $nx_ny >> ./likwidPerformance/AVX_DP_MFLOPs_L2_Norm_Likwid_Performance.dat
-    likwid-perfctr -m -f -g FLOPS_DP -C 0 ./pdeSolver -nx $nx_ny -ny $nx_ny -i 10 -o arquivo_saida | grep "AVX DP MFLOP\/s" | head -1 | grep -o -P "[0-9]+" >> ./likwidPerformance/AVX_DP_MFLOPs_Gauss_Seidel_Likwid_Performance.dat
-    likwid-perfctr -m -f -g FLOPS_DP -C 0 ./pdeSolver -nx $nx_ny -ny $nx_ny -i 10 -o arquivo_saida | grep "AVX DP MFLOP\/s" | tail -1 | grep -o -P "[0-9]+" >> ./likwidPerformance/AVX_DP_MFLOPs_L2_Norm_Likwid_Performance.dat
+    likwid-perfctr -m -f -g FLOPS_DP -C 0 ./pdeSolver -nx $nx_ny -ny $nx_ny -i 10 -o arquivo_saida | region Gauss_Seidel_Likwid_Performance | grep "AVX DP MFLOP\/s" | head -1 | grep -o -P "[0-9]+" >> ./likwidPerformance/AVX_DP_MFLOPs_Gauss_Seidel_Likwid_Performance.dat
+    likwid-perfctr -m -f -g FLOPS_DP -C 0 ./pdeSolver -m rb -nx $nx_ny -ny $nx_ny -i 10 -o arquivo_saida | region L2_Norm_Likwid_Performance | grep "AVX DP MFLOP\/s" | head -1 | grep -o -P "[0-9]+" >> ./likwidPerformance/AVX_DP_MFLOPs_L2_Norm_Likwid_Performance.dat
 done
 
 # Set the processor frequency.
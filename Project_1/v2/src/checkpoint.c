@@ -0,0 +1,336 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+
+#define CHECKPOINT_ALIGNMENT 64  // Alignment of each section of the file.
+
+// Header of the checkpoint file.
+typedef struct checkpointHeader {
+    char magic[8];     // CHECKPOINT_MAGIC.
+    int32_t nx, ny;    // Number of points.
+    int32_t nz;        // Planes of the 3D system the nx * ny grid is a view of (0 for a 2D system).
+    int32_t maxNorms;  // Capacity of the residual history.
+    int32_t slot;      // Slot of the last complete snapshot (-1 if none).
+} checkpointHeader;
+
+// Offsets of the sections of a checkpoint file.
+typedef struct checkpointLayout {
+    size_t norms, its, slots[2], size;
+} checkpointLayout;
+
+/**
+ * @brief Function to round a size up to CHECKPOINT_ALIGNMENT.
+ *
+ * @param bytes Size.
+ * @return size_t
+ */
+static size_t alignSection(size_t bytes) {
+    return (bytes + CHECKPOINT_ALIGNMENT - 1) / CHECKPOINT_ALIGNMENT * CHECKPOINT_ALIGNMENT;
+}
+
+/**
+ * @brief Function to compute the layout of a checkpoint file: header, residual norms, iterations of the norms and the
+ * two slots, each one with a checkpointState followed by "x".
+ *
+ * @param nx Number of points in x.
+ * @param ny Number of points in y.
+ * @param maxNorms Capacity of the residual history.
+ * @return checkpointLayout
+ */
+static checkpointLayout computeLayout(int nx, int ny, int maxNorms) {
+    checkpointLayout layout;
+    size_t slotSize = alignSection(sizeof(checkpointState)) + alignSection((size_t)nx * ny * sizeof(real_t));
+
+    layout.norms = alignSection(sizeof(checkpointHeader));
+    layout.its = layout.norms + alignSection(maxNorms * sizeof(real_t));
+    layout.slots[0] = layout.its + alignSection(maxNorms * sizeof(int32_t));
+    layout.slots[1] = layout.slots[0] + slotSize;
+    layout.size = layout.slots[1] + slotSize;
+
+    return layout;
+}
+
+/**
+ * @brief Function to write the staged snapshot in the slot that does not hold the last complete one.
+ *
+ * The data is copied to the mapping and the header is switched to the new slot only after it. The write back to the
+ * disk is started with msync(MS_ASYNC); the page cache already holds the snapshot, so a killed process does not lose it.
+ * After the first snapshot the file is renamed to its final name, replacing the previous checkpoint in one step.
+ *
+ * @param ckpt Checkpoint struct.
+ */
+static void writeSnapshot(checkpoint *ckpt) {
+    checkpointLayout layout = computeLayout(ckpt->nx, ckpt->ny, ckpt->maxNorms);
+    int slot = ckpt->slot == 0 ? 1 : 0;
+    char *data = ckpt->map + layout.slots[slot];
+
+    // Entries already saved never change.
+    memcpy(ckpt->map + layout.norms, ckpt->norms, ckpt->state.nNorms * sizeof(real_t));
+    memcpy(ckpt->map + layout.its, ckpt->its, ckpt->state.nNorms * sizeof(int32_t));
+
+    memcpy(data, &ckpt->state, sizeof(checkpointState));
+    memcpy(data + alignSection(sizeof(checkpointState)), ckpt->x, (size_t)ckpt->nx * ckpt->ny * sizeof(real_t));
+
+    __sync_synchronize();
+    ((checkpointHeader *)ckpt->map)->slot = slot;
+    ckpt->slot = slot;
+
+    msync(ckpt->map, ckpt->size, MS_ASYNC);
+
+    if (ckpt->tempName && rename(ckpt->tempName, ckpt->fileName) == 0) {
+        free(ckpt->tempName);
+        ckpt->tempName = NULL;
+    }
+}
+
+/**
+ * @brief Function run by the writer thread: writes each staged snapshot, and the last one before exiting.
+ *
+ * @param arg Checkpoint struct.
+ * @return void*
+ */
+static void *checkpointWriter(void *arg) {
+    checkpoint *ckpt = (checkpoint *)arg;
+
+    pthread_mutex_lock(&ckpt->lock);
+    while (1) {
+        while (!ckpt->quit && !ckpt->pending) {
+            pthread_cond_wait(&ckpt->cond, &ckpt->lock);
+        }
+        if (!ckpt->pending) {
+            break;
+        }
+        pthread_mutex_unlock(&ckpt->lock);
+
+        writeSnapshot(ckpt);
+
+        pthread_mutex_lock(&ckpt->lock);
+        ckpt->pending = 0;
+        pthread_cond_broadcast(&ckpt->cond);
+    }
+    pthread_mutex_unlock(&ckpt->lock);
+
+    return NULL;
+}
+
+/**
+ * @brief Function to create a checkpoint file under a temporary name ("<fileName>.tmp"), map it and start its writer
+ * thread. If the thread can not be started the snapshots are written by saveCheckpoint().
+ *
+ * @param ckpt Checkpoint struct.
+ * @param fileName File name.
+ * @param nx Number of points in x.
+ * @param ny Number of points in y.
+ * @param nz Planes of the 3D system the nx * ny grid is a view of (0 for a 2D system).
+ * @param maxNorms Capacity of the residual history.
+ * @return int 0 on success, -1 otherwise.
+ */
+int createCheckpoint(checkpoint *ckpt, const char *fileName, int nx, int ny, int nz, int maxNorms) {
+    checkpointLayout layout = computeLayout(nx, ny, maxNorms);
+    checkpointHeader header;
+    size_t stagingSize = maxNorms * (sizeof(real_t) + sizeof(int32_t)) + (size_t)nx * ny * sizeof(real_t);
+    int fd;
+
+    memset(ckpt, 0, sizeof(checkpoint));
+    ckpt->fileName = strdup(fileName);
+    ckpt->tempName = (char *)malloc(strlen(fileName) + 5);
+    ckpt->x = (real_t *)malloc(stagingSize);
+    if (!ckpt->fileName || !ckpt->tempName || !ckpt->x) {
+        free(ckpt->fileName);
+        free(ckpt->tempName);
+        free(ckpt->x);
+        return -1;
+    }
+    ckpt->norms = ckpt->x + (size_t)nx * ny;
+    ckpt->its = (int32_t *)(ckpt->norms + maxNorms);
+    sprintf(ckpt->tempName, "%s.tmp", fileName);
+
+    fd = open(ckpt->tempName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0 && ftruncate(fd, layout.size) == 0) {
+        ckpt->map = mmap(NULL, layout.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    } else {
+        ckpt->map = MAP_FAILED;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    if (ckpt->map == MAP_FAILED) {
+        unlink(ckpt->tempName);
+        free(ckpt->fileName);
+        free(ckpt->tempName);
+        free(ckpt->x);
+        return -1;
+    }
+
+    ckpt->size = layout.size;
+    ckpt->nx = nx;
+    ckpt->ny = ny;
+    ckpt->maxNorms = maxNorms;
+    ckpt->slot = -1;
+
+    memset(&header, 0, sizeof(checkpointHeader));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.nx = nx;
+    header.ny = ny;
+    header.nz = nz;
+    header.maxNorms = maxNorms;
+    header.slot = -1;
+    memcpy(ckpt->map, &header, sizeof(checkpointHeader));
+
+    pthread_mutex_init(&ckpt->lock, NULL);
+    pthread_cond_init(&ckpt->cond, NULL);
+    ckpt->threaded = pthread_create(&ckpt->writer, NULL, checkpointWriter, ckpt) == 0;
+
+    return 0;
+}
+
+/**
+ * @brief Function to save a snapshot.
+ *
+ * The snapshot is copied to the staging buffer, once the previous one has been written, and handed to the writer
+ * thread. The copy of "x" to the staging buffer is still done by the caller, one pass over "x"; the copy to the mapping,
+ * its page faults and the write back overlap with the next sweeps.
+ *
+ * @param ckpt Checkpoint struct.
+ * @param x Solution.
+ * @param state Solver state (state->nNorms must not exceed the capacity of the file).
+ * @param arrayL2Norm Residual norms (state->nNorms).
+ * @param arrayIt Iterations of the residual norms (state->nNorms).
+ */
+void saveCheckpoint(checkpoint *ckpt, const real_t *x, const checkpointState *state, const real_t *arrayL2Norm, const int *arrayIt) {
+    pthread_mutex_lock(&ckpt->lock);
+    while (ckpt->pending) {
+        pthread_cond_wait(&ckpt->cond, &ckpt->lock);
+    }
+    pthread_mutex_unlock(&ckpt->lock);
+
+    ckpt->state = *state;
+    memcpy(ckpt->norms, arrayL2Norm, state->nNorms * sizeof(real_t));
+    for (int i = 0; i < state->nNorms; i++) {
+        ckpt->its[i] = arrayIt[i];
+    }
+    memcpy(ckpt->x, x, (size_t)ckpt->nx * ckpt->ny * sizeof(real_t));
+
+    if (!ckpt->threaded) {
+        writeSnapshot(ckpt);
+        return;
+    }
+
+    pthread_mutex_lock(&ckpt->lock);
+    ckpt->pending = 1;
+    pthread_cond_broadcast(&ckpt->cond);
+    pthread_mutex_unlock(&ckpt->lock);
+}
+
+/**
+ * @brief Function to wait for the last snapshot to be written, stop the writer thread and unmap the file. The pending
+ * write back is left to the system. A file that never got a snapshot is removed.
+ *
+ * @param ckpt Checkpoint struct.
+ */
+void closeCheckpoint(checkpoint *ckpt) {
+    if (ckpt->threaded) {
+        pthread_mutex_lock(&ckpt->lock);
+        ckpt->quit = 1;
+        pthread_cond_broadcast(&ckpt->cond);
+        pthread_mutex_unlock(&ckpt->lock);
+        pthread_join(ckpt->writer, NULL);
+    }
+
+    munmap(ckpt->map, ckpt->size);
+    ckpt->map = NULL;
+
+    if (ckpt->tempName) {
+        unlink(ckpt->tempName);
+    }
+
+    pthread_mutex_destroy(&ckpt->lock);
+    pthread_cond_destroy(&ckpt->cond);
+    free(ckpt->fileName);
+    free(ckpt->tempName);
+    free(ckpt->x);
+}
+
+/**
+ * @brief Function to read the last complete snapshot of a checkpoint file.
+ *
+ * @param fileName File name.
+ * The header and the state are checked before they are used: the snapshot must have done at most maxIt sweeps, and
+ * at most one residual evaluation per sweep within the capacity of the history.
+ *
+ * @param nx Number of points in x (must match the file).
+ * @param ny Number of points in y (must match the file).
+ * @param nz Planes of the 3D system the grid is a view of, 0 for a 2D system (must match the file).
+ * @param maxIt Number of max iterations of the run that resumes.
+ * @param x Receives the solution (nx * ny).
+ * @param state Receives the solver state.
+ * @param arrayL2Norm Receives a new array with the state->nNorms residual norms.
+ * @param arrayIt Receives a new array with the iterations of the residual norms.
+ * @return int 0 on success, -1 if the file can not be read, does not match the mesh or the run, or has no snapshot.
+ */
+int loadCheckpoint(const char *fileName, int nx, int ny, int nz, int maxIt, real_t *x, checkpointState *state, real_t **arrayL2Norm, int **arrayIt) {
+    checkpointHeader header;
+    checkpointLayout layout;
+    struct stat info;
+    char *map;
+    int fd;
+
+    fd = open(fileName, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(checkpointHeader)) {
+        close(fd);
+        return -1;
+    }
+
+    map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    memcpy(&header, map, sizeof(checkpointHeader));
+
+    if (memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0 || header.nx != nx || header.ny != ny || header.nz != nz || header.maxNorms < 0 || header.slot < 0 || header.slot > 1) {
+        munmap(map, info.st_size);
+        return -1;
+    }
+
+    layout = computeLayout(header.nx, header.ny, header.maxNorms);
+    if ((size_t)info.st_size < layout.size) {
+        munmap(map, info.st_size);
+        return -1;
+    }
+
+    const char *data = map + layout.slots[header.slot];
+    const int32_t *its = (const int32_t *)(map + layout.its);
+
+    memcpy(state, data, sizeof(checkpointState));
+    if (state->it < 0 || state->it > maxIt || state->nNorms < 0 || state->nNorms > header.maxNorms || state->nNorms > state->it) {
+        munmap(map, info.st_size);
+        return -1;
+    }
+
+    memcpy(x, data + alignSection(sizeof(checkpointState)), (size_t)nx * ny * sizeof(real_t));
+
+    *arrayL2Norm = (real_t *)malloc((state->nNorms + 1) * sizeof(real_t));
+    *arrayIt = (int *)malloc((state->nNorms + 1) * sizeof(int));
+    memcpy(*arrayL2Norm, map + layout.norms, state->nNorms * sizeof(real_t));
+    for (int i = 0; i < state->nNorms; i++) {
+        (*arrayIt)[i] = its[i];
+    }
+
+    munmap(map, info.st_size);
+
+    return 0;
+}
@@ -0,0 +1,263 @@
+#include <math.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mpiSolver.h"
+#include "partialDifferential.h"
+#include "simdKernels.h"
+
+/**
+ * @brief Function to split the mesh in row slabs, one per rank, and build the local system of this rank.
+ *
+ * The first ny % size ranks get one extra row. The coefficients and the right-hand side are the ones of the global
+ * mesh, so the slabs together hold the same system as setLinearSystem().
+ *
+ * @param nx Number of points in x.
+ * @param ny Number of points in y (at least the number of ranks).
+ * @param prob Problem.
+ * @param hugePages Back the local arena with 2MB pages.
+ * @return mpiSlab Slab struct (local.arena is NULL if the allocation failed).
+ */
+mpiSlab initMpiSlab(int nx, int ny, const problem *prob, int hugePages) {
+    mpiSlab slab;
+    linearSystem global;
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &slab.rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &slab.size);
+
+    int rows = ny / slab.size + (slab.rank < ny % slab.size);
+
+    slab.nx = nx;
+    slab.ny = ny;
+    slab.j0 = slab.rank * (ny / slab.size) + (slab.rank < ny % slab.size ? slab.rank : ny % slab.size);
+    slab.below = slab.rank > 0 ? slab.rank - 1 : MPI_PROC_NULL;
+    slab.above = slab.rank < slab.size - 1 ? slab.rank + 1 : MPI_PROC_NULL;
+
+    // Stencil of the global mesh, no array is needed.
+    memset(&global, 0, sizeof(linearSystem));
+    global.matrixFree = 1;
+    global.nx = nx;
+    global.ny = ny;
+    global.prob = prob;
+    setStencil(&global);
+
+    // The halo rows are allocated as rows of the local system and zeroed, which is the boundary value of the mesh.
+    slab.local = initLinearSystem(nx, rows + 2, 1, hugePages);
+    slab.local.coef = global.coef;
+    slab.local.prob = prob;
+
+    if (slab.local.arena) {
+        slab.local.ny = rows;
+        slab.local.b += nx;
+        slab.local.x += nx;
+        setRightHandSide(&global, slab.local.b, slab.j0, rows);
+    }
+
+    return slab;
+}
+
+/**
+ * @brief Function to free the local system of a slab.
+ *
+ * @param slab Slab struct.
+ */
+void freeMpiSlab(mpiSlab *slab) {
+    freeLinearSystem(&slab->local);
+}
+
+/**
+ * @brief Function to copy the boundary rows of the slab to the halo rows of the neighbors.
+ *
+ * @param slab Slab struct.
+ */
+static void exchangeHalos(mpiSlab *slab) {
+    int nx = slab->nx, rows = slab->local.ny;
+    real_t *x = slab->local.x;
+
+    // First row goes down, the upper halo comes from above.
+    MPI_Sendrecv(x, nx, MPI_DOUBLE, slab->below, 0, x + rows * nx, nx, MPI_DOUBLE, slab->above, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+    // Last row goes up, the lower halo comes from below.
+    MPI_Sendrecv(x + (rows - 1) * nx, nx, MPI_DOUBLE, slab->above, 1, x - nx, nx, MPI_DOUBLE, slab->below, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+}
+
+/**
+ * @brief Function to update the points of one color of the slab, split across OpenMP threads.
+ *
+ * The color is the parity of the global i + j, and the halo rows replace the edge tests of the rows, so the iterates are
+ * the ones of redBlackGaussSeidel() in matrix-free mode.
+ *
+ * @param slab Slab struct.
+ * @param color Color (0 is red, 1 is black).
+ * @param omega Relaxation factor.
+ */
+static void mpiColorSweep(mpiSlab *slab, int color, real_t omega) {
+    int nx = slab->nx, rows = slab->local.ny;
+    real_t *x = slab->local.x;
+    const real_t *b = slab->local.b;
+    stencil c = slab->local.coef;
+
+#pragma omp parallel for schedule(static)
+    for (int j = 0; j < rows; j++) {
+        for (int i = (slab->j0 + j + color) % 2; i < nx; i += 2) {
+            int k = j * nx + i;
+            real_t sum = 0.0, gs;
+
+            if (i > 0) {
+                sum += c.id * x[k - 1];
+            }
+            if (i < nx - 1) {
+                sum += c.sd * x[k + 1];
+            }
+            sum += c.iid * x[k - nx];
+            sum += c.ssd * x[k + nx];
+
+            gs = (b[k] - sum) / c.md;
+            x[k] = omega == 1.0 ? gs : x[k] + omega * (gs - x[k]);
+        }
+    }
+}
+
+/**
+ * @brief Function to compute the L2 norm of the residual of the whole mesh.
+ *
+ * The halos are refreshed, each rank sums the squared residuals of its rows and the sums are added by an allreduce, so
+ * every rank gets the same value.
+ *
+ * @param slab Slab struct.
+ * @return real_t
+ */
+real_t mpiL2Norm(mpiSlab *slab) {
+    int nx = slab->nx, rows = slab->local.ny;
+    const real_t *x = slab->local.x, *b = slab->local.b;
+    stencil c = slab->local.coef;
+    real_t local = 0.0, global;
+
+    exchangeHalos(slab);
+
+#pragma omp parallel for reduction(+ : local) schedule(static)
+    for (int j = 0; j < rows; j++) {
+        int k = j * nx, end = k + nx - 1;
+        real_t r;
+
+        r = (b[k] - (c.sd * x[k + 1]) - (c.ssd * x[k + nx]) - (c.iid * x[k - nx])) - c.md * x[k];
+        local += r * r + kernels.residualSquaresStencil(&slab->local, k + 1, end);
+        r = (b[end] - (c.ssd * x[end + nx]) - (c.id * x[end - 1]) - (c.iid * x[end - nx])) - c.md * x[end];
+        local += r * r;
+    }
+
+    MPI_Allreduce(&local, &global, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+    return sqrt(global);
+}
+
+/**
+ * @brief Function to do nSweeps distributed red-black sweeps, the halos are exchanged before each color.
+ *
+ * @param linSys Unused, the system is the slab.
+ * @param opts Solver options.
+ * @param data Slab struct.
+ * @param nSweeps Number of sweeps.
+ * @return real_t L2 norm of the residual of the whole mesh after the last sweep.
+ */
+static real_t mpiRedBlackSweeps(linearSystem *linSys, const solverOptions *opts, void *data, int nSweeps) {
+    mpiSlab *slab = (mpiSlab *)data;
+
+    for (int t = 0; t < nSweeps; t++) {
+        exchangeHalos(slab);
+        mpiColorSweep(slab, 0, opts->omega);
+        exchangeHalos(slab);
+        mpiColorSweep(slab, 1, opts->omega);
+    }
+
+    return mpiL2Norm(slab);
+}
+
+/**
+ * @brief Distributed red-black Gauss Seidel function. All ranks must call it; only rank 0 writes the report.
+ *
+ * @param slab Slab struct.
+ * @param opts Solver options.
+ * @param output Output file of rank 0.
+ */
+void mpiRedBlackGaussSeidel(mpiSlab *slab, const solverOptions *opts, FILE *output) {
+    iterativeSolve(&slab->local, opts, slab->rank == 0 ? output : NULL, mpiRedBlackSweeps, slab);
+
+    if (slab->rank == 0) {
+        fprintf(output, "# Processos MPI: %d\n", slab->size);
+    }
+}
+
+/**
+ * @brief Function to gather the solution on rank 0 and print it as printMesh() does. All ranks must call it.
+ *
+ * @param slab Slab struct.
+ * @param output Output file of rank 0.
+ */
+void printMpiMesh(mpiSlab *slab, FILE *output) {
+    linearSystem mesh;
+    int *counts = NULL, *displs = NULL;
+
+    if (slab->rank == 0) {
+        mesh = initLinearSystem(slab->nx, slab->ny, 1, 0);
+        mesh.prob = slab->local.prob;
+        counts = (int *)malloc(slab->size * sizeof(int));
+        displs = (int *)malloc(slab->size * sizeof(int));
+
+        for (int r = 0; r < slab->size; r++) {
+            counts[r] = (slab->ny / slab->size + (r < slab->ny % slab->size)) * slab->nx;
+            displs[r] = r > 0 ? displs[r - 1] + counts[r - 1] : 0;
+        }
+    }
+
+    MPI_Gatherv(slab->local.x, slab->local.ny * slab->nx, MPI_DOUBLE, slab->rank == 0 ? mesh.x : NULL, counts, displs, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    if (slab->rank == 0) {
+        printMesh(&mesh, output);
+        freeLinearSystem(&mesh);
+        free(counts);
+        free(displs);
+    }
+}
+
+/**
+ * @brief Function to write the solution in the format of writeMeshBinary(), each rank writing its own rows with MPI-IO.
+ * All ranks must call it.
+ *
+ * @param slab Slab struct.
+ * @param fileName File name.
+ * @return int 0 on success, -1 otherwise (on every rank).
+ */
+int writeMpiMeshBinary(mpiSlab *slab, const char *fileName) {
+    MPI_File file;
+    meshHeader header;
+    MPI_Offset offset = sizeof(meshHeader) + (MPI_Offset)slab->j0 * slab->nx * sizeof(real_t);
+    int error, anyError;
+
+    error = MPI_File_open(MPI_COMM_WORLD, fileName, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS;
+
+    if (!error) {
+        MPI_File_set_size(file, 0);
+
+        if (slab->rank == 0) {
+            memset(&header, 0, sizeof(meshHeader));
+            memcpy(header.magic, MESH_MAGIC, sizeof(header.magic));
+            header.nx = slab->nx;
+            header.ny = slab->ny;
+            header.hx = (slab->local.prob->x1 - slab->local.prob->x0) / (slab->nx + 1);
+            header.hy = (slab->local.prob->y1 - slab->local.prob->y0) / (slab->ny + 1);
+            header.x0 = slab->local.prob->x0;
+            header.y0 = slab->local.prob->y0;
+            error |= MPI_File_write_at(file, 0, &header, sizeof(meshHeader), MPI_BYTE, MPI_STATUS_IGNORE) != MPI_SUCCESS;
+        }
+
+        error |= MPI_File_write_at_all(file, offset, slab->local.x, slab->local.ny * slab->nx, MPI_DOUBLE, MPI_STATUS_IGNORE) != MPI_SUCCESS;
+        MPI_File_close(&file);
+    }
+
+    MPI_Allreduce(&error, &anyError, 1, MPI_INT, MPI_LOR, MPI_COMM_WORLD);
+
+    return anyError ? -1 : 0;
+}
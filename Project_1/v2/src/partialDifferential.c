@@ -1,496 +1,2695 @@
-#include <likwid.h>
-#include <math.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-#include "partialDifferential.h"
-#include "utils.h"
-
-#define M_PI 3.14159265358979323846
-#define SQR_PI M_PI *M_PI
-#define X_Y_FUNCTION(i, j) (4 * SQR_PI) * ((sin(2 * M_PI * (i)) * sinh(M_PI * (j))) + (sin(2 * M_PI * (M_PI - (i))) * (sinh(M_PI * (M_PI - (j))))))
-
-/**
- * @brief Function to allocate space in memory.
- *
- * @param nx Number of points in x.
- * @param ny Number of points in y.
- * @return linearSystem Linear system struct.
- */
-linearSystem initLinearSystem(int nx, int ny) {
-    linearSystem linSys;
-
-    linSys.ssd = (real_t *)malloc((nx * ny) * sizeof(real_t));
-    memset(linSys.ssd, 0.0, (nx * ny) * sizeof(real_t));
-
-    linSys.sd = (real_t *)malloc((nx * ny) * sizeof(real_t));
-    memset(linSys.sd, 0.0, (nx * ny) * sizeof(real_t));
-
-    linSys.md = (real_t *)malloc((nx * ny) * sizeof(real_t));
-    memset(linSys.md, 0.0, (nx * ny) * sizeof(real_t));
-
-    linSys.id = (real_t *)malloc((nx * ny) * sizeof(real_t));
-    memset(linSys.id, 0.0, (nx * ny) * sizeof(real_t));
-
-    linSys.iid = (real_t *)malloc((nx * ny) * sizeof(real_t));
-    memset(linSys.iid, 0.0, (nx * ny) * sizeof(real_t));
-
-    linSys.b = (real_t *)malloc((nx * ny) * sizeof(real_t));
-
-    linSys.x = (real_t *)malloc((nx * ny) * sizeof(real_t));
-    memset(linSys.x, 0.0, (nx * ny) * sizeof(real_t));
-
-    linSys.nx = nx;
-    linSys.ny = ny;
-
-    return linSys;
-}
-
-/**
- * @brief Set the Linear System object
- *
- * @param linSys Linear system struct.
- */
-void setLinearSystem(linearSystem *linSys) {
-    real_t hx, hy, sqrHx, sqrHy;
-
-    hx = M_PI / (linSys->nx + 1);
-    hy = M_PI / (linSys->ny + 1);
-
-    sqrHx = hx * hx;
-    sqrHy = hy * hy;
-
-    // ------------------------------------------------ FILL A DIAGONAL MATRIX ------------------------------------------------
-
-    // Superior superior diagonal.
-    for (int i = 0; i < (linSys->nx * linSys->ny) - linSys->nx; i++) {
-        linSys->ssd[i] = sqrHx * (hy - 2);
-    }
-
-    // Superior diagonal.
-    for (int k = 0; k < linSys->nx * linSys->ny; k++) {
-        if ((k + 1) % linSys->nx != 0) {
-            linSys->sd[k] = sqrHy * (hx - 2);
-        }
-    }
-
-    // Main diagonal
-    for (int i = 0; i < linSys->nx * linSys->ny; i++) {
-        linSys->md[i] = 4 * (sqrHy + sqrHx + 2 * SQR_PI * sqrHx * sqrHy);
-    }
-
-    // Inferior diagonal
-    for (int k = 0; k < linSys->nx * linSys->ny; k++) {
-        if (k % linSys->nx != 0) {
-            linSys->id[k] = sqrHy * (-2 - hx);
-        }
-    }
-
-    // Inferior inferior diagonal
-    for (int i = linSys->nx; i < linSys->nx * linSys->ny; i++) {
-        linSys->iid[i] = sqrHx * (-2 - hy);
-    }
-
-    // ------------------------------------------------ FILL B ARRAY ------------------------------------------------
-
-    int idxB = 0;
-
-    for (int j = 1; j <= linSys->ny; j++) {
-        for (int i = 1; i <= linSys->nx; i++) {
-            linSys->b[idxB] = (2 * sqrHx * sqrHy) * X_Y_FUNCTION(0 + i * hx, 0 + j * hy);
-
-            // Bottom edge of the mesh.
-            if (j == 1) {
-                linSys->b[idxB] -= (sin(2 * M_PI * (M_PI - i * hx)) * sinh(SQR_PI)) * (sqrHx * (-2 - hy));
-            }
-
-            // Left edge of the mesh (zero).
-            if (i == 1) {
-                linSys->b[idxB] -= 0;
-            }
-
-            // Upper edge of the mesh.
-            if (j == linSys->ny) {
-                linSys->b[idxB] -= (sin(2 * M_PI * i * hx) * sinh(SQR_PI)) * (sqrHx * (hy - 2));
-            }
-
-            // Right edge of the mesh (zero).
-            if (i == linSys->nx) {
-                linSys->b[idxB] -= 0;
-            }
-
-            idxB++;
-        }
-    }
-}
-
-/**
- * @brief Function to calculate L2 norm.
- *
- * @param linSys Linear system struct.
- * @return real_t
- */
-real_t l2Norm(linearSystem *linSys) {  // Retirado os if dos for.
-    real_t *temp = (real_t *)malloc((linSys->nx * linSys->ny) * sizeof(real_t));
-
-    int i = 0;
-
-    // primeira equação fora do laço
-    temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx])) - linSys->md[i] * linSys->x[i];
-
-    // for  ate o inicio da diagonal inferior inferior
-    for (i = 1; i < linSys->nx; i++) {
-        temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) - linSys->md[i] * linSys->x[i];
-    }
-    // equações com todas as diagonais
-    for (; i < linSys->nx * linSys->ny - linSys->nx; i++) {
-        temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->iid[i] * linSys->x[i - linSys->nx])) - linSys->md[i] * linSys->x[i];
-    }
-    // for ate o final da diagonal inferior inferior
-    for (; i < (linSys->nx * linSys->ny - 1); i++) {
-        temp[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->sd[i] * linSys->x[i + 1])) - linSys->md[i] * linSys->x[i];
-    }
-    // ultima equação fora do laço
-    temp[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) - linSys->md[i] * linSys->x[i];
-
-    real_t result = 0.0;
-
-    for (int i = 0; i < linSys->nx * linSys->ny; i++) {
-        result += temp[i] * temp[i];
-    }
-
-    return sqrt(result);
-}
-
-// real_t l2Norm(linearSystem *linSys) {  // Loop unroll de 2.
-//     real_t *temp = (real_t *)malloc((linSys->nx * linSys->ny) * sizeof(real_t));
-//     int aux, i = 0;
-
-//     // primeira equação fora do laço
-//     temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx])) - linSys->md[i] * linSys->x[i];
-
-//     // for  ate o inicio da diagonal inferior inferior
-//     aux = linSys->nx;
-//     aux -= aux % 2;
-//     for (i = 1; i < aux; i += 2) {
-//         temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) - linSys->md[i] * linSys->x[i];
-//         temp[i + 1] = (linSys->b[i + 1] - (linSys->sd[i + 1] * linSys->x[i + 2]) - (linSys->ssd[i + 1] * linSys->x[i + linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i])) - linSys->md[i + 1] * linSys->x[i + 1];
-//     }
-//     for (; i < linSys->nx; i++) {
-//         temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) - linSys->md[i] * linSys->x[i];
-//     }
-
-//     // equações com todas as diagonais
-//     aux = linSys->nx * linSys->ny - linSys->nx;
-//     aux -= aux % 2;
-//     for (; i < aux; i += 2) {
-//         temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->iid[i] * linSys->x[i - linSys->nx])) - linSys->md[i] * linSys->x[i];
-//         temp[i + 1] = (linSys->b[i + 1] - (linSys->sd[i + 1] * linSys->x[i + 2]) - (linSys->ssd[i + 1] * linSys->x[i + linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i]) - (linSys->iid[i + 1] * linSys->x[i - linSys->nx + 1])) - linSys->md[i + 1] * linSys->x[i + 1];
-//     }
-//     for (; i < linSys->nx * linSys->ny - linSys->nx; i++) {
-//         temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->iid[i] * linSys->x[i - linSys->nx])) - linSys->md[i] * linSys->x[i];
-//     }
-
-//     // for ate o final da diagonal inferior inferior
-//     aux = linSys->nx * linSys->ny - 1;
-//     aux -= aux % 2;
-//     for (; i < aux; i += 2) {
-//         temp[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->sd[i] * linSys->x[i + 1])) - linSys->md[i] * linSys->x[i];
-//         temp[i + 1] = (linSys->b[i + 1] - (linSys->iid[i + 1] * linSys->x[i - linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i]) - (linSys->sd[i + 1] * linSys->x[i + 2])) - linSys->md[i + 1] * linSys->x[i + 1];
-//     }
-//     for (; i < (linSys->nx * linSys->ny - 1); i++) {
-//         temp[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->sd[i] * linSys->x[i + 1])) - linSys->md[i] * linSys->x[i];
-//     }
-
-//     // ultima equação fora do laço
-//     temp[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) - linSys->md[i] * linSys->x[i];
-
-//     real_t result = 0.0;
-
-//     // raiz dos quadrados dos residuos
-//     for (i = 0; i < aux; i++) {
-//         result += temp[i] * temp[i];
-//     }
-
-//     return sqrt(result);
-// }
-
-// real_t l2Norm(linearSystem *linSys) {  // Loop unroll de 4.
-//     real_t *temp = (real_t *)malloc((linSys->nx * linSys->ny) * sizeof(real_t));
-//     int aux, i = 0;
-
-//     // primeira equação fora do laço
-//     temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx])) - linSys->md[i] * linSys->x[i];
-
-//     // for  ate o inicio da diagonal inferior inferior
-//     aux = linSys->nx;
-//     aux -= aux % 4;
-//     for (i = 1; i < aux; i += 4) {
-//         temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) - linSys->md[i] * linSys->x[i];
-//         temp[i + 1] = (linSys->b[i + 1] - (linSys->sd[i + 1] * linSys->x[i + 2]) - (linSys->ssd[i + 1] * linSys->x[i + linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i])) - linSys->md[i + 1] * linSys->x[i + 1];
-//         temp[i + 2] = (linSys->b[i + 2] - (linSys->sd[i + 2] * linSys->x[i + 3]) - (linSys->ssd[i + 2] * linSys->x[i + linSys->nx + 2]) - (linSys->id[i + 2] * linSys->x[i + 1])) - linSys->md[i + 2] * linSys->x[i + 2];
-//         temp[i + 3] = (linSys->b[i + 3] - (linSys->sd[i + 3] * linSys->x[i + 4]) - (linSys->ssd[i + 3] * linSys->x[i + linSys->nx + 3]) - (linSys->id[i + 3] * linSys->x[i + 2])) - linSys->md[i + 3] * linSys->x[i + 3];
-//     }
-//     for (; i < linSys->nx; i++) {
-//         temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) - linSys->md[i] * linSys->x[i];
-//     }
-
-//     // equações com todas as diagonais
-//     aux = linSys->nx * linSys->ny - linSys->nx;
-//     aux -= aux % 4;
-//     for (; i < aux; i += 4) {
-//         temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->iid[i] * linSys->x[i - linSys->nx])) - linSys->md[i] * linSys->x[i];
-//         temp[i + 1] = (linSys->b[i + 1] - (linSys->sd[i + 1] * linSys->x[i + 2]) - (linSys->ssd[i + 1] * linSys->x[i + linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i]) - (linSys->iid[i + 1] * linSys->x[i - linSys->nx + 1])) - linSys->md[i + 1] * linSys->x[i + 1];
-//         temp[i + 2] = (linSys->b[i + 2] - (linSys->sd[i + 2] * linSys->x[i + 3]) - (linSys->ssd[i + 2] * linSys->x[i + linSys->nx + 2]) - (linSys->id[i + 2] * linSys->x[i + 1]) - (linSys->iid[i + 2] * linSys->x[i - linSys->nx + 2])) - linSys->md[i + 2] * linSys->x[i + 2];
-//         temp[i + 3] = (linSys->b[i + 3] - (linSys->sd[i + 3] * linSys->x[i + 4]) - (linSys->ssd[i + 3] * linSys->x[i + linSys->nx + 3]) - (linSys->id[i + 3] * linSys->x[i + 2]) - (linSys->iid[i + 3] * linSys->x[i - linSys->nx + 3])) - linSys->md[i + 3] * linSys->x[i + 3];
-//     }
-//     for (; i < linSys->nx * linSys->ny - linSys->nx; i++) {
-//         temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->iid[i] * linSys->x[i - linSys->nx])) - linSys->md[i] * linSys->x[i];
-//     }
-
-//     // for ate o final da diagonal inferior inferior
-//     aux = linSys->nx * linSys->ny - 1;
-//     aux -= aux % 4;
-//     for (; i < aux; i += 4) {
-//         temp[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->sd[i] * linSys->x[i + 1])) - linSys->md[i] * linSys->x[i];
-//         temp[i + 1] = (linSys->b[i + 1] - (linSys->iid[i + 1] * linSys->x[i - linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i]) - (linSys->sd[i + 1] * linSys->x[i + 2])) - linSys->md[i + 1] * linSys->x[i + 1];
-//         temp[i + 2] = (linSys->b[i + 2] - (linSys->iid[i + 2] * linSys->x[i - linSys->nx + 2]) - (linSys->id[i + 2] * linSys->x[i + 1]) - (linSys->sd[i + 2] * linSys->x[i + 3])) - linSys->md[i + 2] * linSys->x[i + 2];
-//         temp[i + 3] = (linSys->b[i + 3] - (linSys->iid[i + 3] * linSys->x[i - linSys->nx + 3]) - (linSys->id[i + 3] * linSys->x[i + 2]) - (linSys->sd[i + 3] * linSys->x[i + 4])) - linSys->md[i + 3] * linSys->x[i + 3];
-//     }
-//     for (; i < (linSys->nx * linSys->ny - 1); i++) {
-//         temp[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->sd[i] * linSys->x[i + 1])) - linSys->md[i] * linSys->x[i];
-//     }
-
-//     // ultima equação fora do laço
-//     temp[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) - linSys->md[i] * linSys->x[i];
-
-//     real_t result = 0.0;
-
-//     // raiz dos quadrados dos residuos
-//     for (i = 0; i < aux; i++) {
-//         result += temp[i] * temp[i];
-//     }
-
-//     return sqrt(result);
-// }
-
-/**
- * @brief Function to print the discretization matrix.
- *
- * @param linSys LinearSystem structure
- * @param output Output file.
- */
-void printMesh(linearSystem *linSys, FILE *output) {
-    real_t hx, hy;
-
-    hx = M_PI / (linSys->nx + 1);
-    hy = M_PI / (linSys->ny + 1);
-
-    if (!output) {
-        output = stdout;
-    }
-
-    int k = 0;
-
-    for (int j = 1; j < linSys->ny; j++) {
-        for (int i = 1; i < linSys->nx; i++) {
-            fprintf(output, "%lf %lf %lf\n", i * hx, j * hy, linSys->x[k++]);
-        }
-    }
-}
-
-/**
- * @brief Function to print Gauss Seidel parameters.
- *
- * @param avrgTime Average time.
- * @param arrayL2Norm Array with all L2 norms.
- * @param output Output file.
- * @param it Number of iterations.
- */
-void printGaussSeidelParameters(real_t avrgTime, real_t *arrayL2Norm, FILE *output, int it) {
-    fprintf(output, "###########\n");
-
-    fprintf(output, "# Tempo Método GS: %lfms\n", avrgTime);
-    fprintf(output, "#\n");
-
-    // ----------------------------------------------- L2 Norm -----------------------------------------------
-
-    fprintf(output, "# Norma L2 do Residuo\n");
-
-    for (int i = 0; i < it; i++) {
-        fprintf(output, "#i = %d : %lf\n", i, arrayL2Norm[i]);
-    }
-
-    fprintf(output, "###########\n");
-}
-
-/**
- * @brief Gauss Seidel function.
- *
- * @param linSys Linear system struct.
- * @param it Number of max iterations.
- */
-void gaussSeidel(linearSystem *linSys, int it, FILE *output) {  // Retirado os if dos for.
-    real_t itTime, *arrayL2Norm, acumItTime;
-    int i, k = 0;
-    acumItTime = 0.0;
-    arrayL2Norm = (real_t *)malloc(it * sizeof(real_t));
-
-    LIKWID_MARKER_START("Gauss_Seidel_Likwid_Performance");
-    while (k < it) {
-        itTime = timestamp();
-        i = 0;
-
-        // primeira equação fora do laço
-        linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx])) / linSys->md[i];
-
-        // for  ate o inicio da diagonal inferior inferior
-        for (i = 1; i < linSys->nx; i++) {
-            linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) / linSys->md[i];
-        }
-        // equações com todas as diagonais
-        for (; i < linSys->nx * linSys->ny - linSys->nx; i++) {
-            linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->iid[i] * linSys->x[i - linSys->nx])) / linSys->md[i];
-        }
-        // for ate o final da diagonal inferior inferior
-        for (; i < (linSys->nx * linSys->ny - 1); i++) {
-            linSys->x[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->sd[i] * linSys->x[i + 1])) / linSys->md[i];
-        }
-        // ultima equação fora do laço
-        linSys->x[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) / linSys->md[i];
-
-        acumItTime += timestamp() - itTime;
-        LIKWID_MARKER_START("L2_Norm_Likwid_Performance");
-        arrayL2Norm[k] = l2Norm(linSys);
-        LIKWID_MARKER_STOP("L2_Norm_Likwid_Performance");
-        k++;
-    }
-    LIKWID_MARKER_STOP("Gauss_Seidel_Likwid_Performance");
-
-    printGaussSeidelParameters(acumItTime / (it), arrayL2Norm, output, it);
-}
-
-// void gaussSeidel(linearSystem *linSys, int it, FILE *output) {  // Loop unroll de 2.
-//     real_t itTime, *arrayL2Norm, acumItTime;
-//     int i, aux, k = 0;
-//     acumItTime = 0.0;
-//     arrayL2Norm = (real_t *)malloc(it * sizeof(real_t));
-
-//     LIKWID_MARKER_START("Gauss_Seidel_Likwid_Performance");
-//     while (k < it) {
-//         itTime = timestamp();
-//         i = 0;
-
-//         // primeira equação fora do laço
-//         linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx])) / linSys->md[i];
-
-//         // for  ate o inicio da diagonal inferior inferior
-//         aux = linSys->nx;
-//         aux -= aux % 2;
-//         for (i = 1; i < aux; i += 2) {
-//             linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) / linSys->md[i];
-//             linSys->x[i + 1] = (linSys->b[i + 1] - (linSys->sd[i + 1] * linSys->x[i + 2]) - (linSys->ssd[i + 1] * linSys->x[i + linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i])) / linSys->md[i + 1];
-//         }
-//         for (; i < linSys->nx; i++) {
-//             linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) / linSys->md[i];
-//         }
-
-//         // equações com todas as diagonais
-//         aux = linSys->nx * linSys->ny - linSys->nx;
-//         aux -= aux % 2;
-//         for (; i < aux; i += 2) {
-//             linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->iid[i] * linSys->x[i - linSys->nx])) / linSys->md[i];
-//             linSys->x[i + 1] = (linSys->b[i + 1] - (linSys->sd[i + 1] * linSys->x[i + 2]) - (linSys->ssd[i + 1] * linSys->x[i + linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i]) - (linSys->iid[i + 1] * linSys->x[i - linSys->nx + 1])) / linSys->md[i + 1];
-//         }
-//         for (; i < linSys->nx * linSys->ny - linSys->nx; i++) {
-//             linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->iid[i] * linSys->x[i - linSys->nx])) / linSys->md[i];
-//         }
-//         // for ate o final da diagonal inferior inferior
-//         aux = linSys->nx * linSys->ny - 1;
-//         aux -= aux % 2;
-//         for (; i < aux; i += 2) {
-//             linSys->x[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->sd[i] * linSys->x[i + 1])) / linSys->md[i];
-//             linSys->x[i + 1] = (linSys->b[i + 1] - (linSys->iid[i + 1] * linSys->x[i - linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i]) - (linSys->sd[i + 1] * linSys->x[i + 2])) / linSys->md[i + 1];
-//         }
-//         for (; i < linSys->nx * linSys->ny - 1; i++) {
-//             linSys->x[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->sd[i] * linSys->x[i + 1])) / linSys->md[i];
-//         }
-//         // ultima equação fora do laço
-//         linSys->x[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) / linSys->md[i];
-
-//         acumItTime += timestamp() - itTime;
-//         LIKWID_MARKER_START("L2_Norm_Likwid_Performance");
-//         arrayL2Norm[k] = l2Norm(linSys);
-//         LIKWID_MARKER_STOP("L2_Norm_Likwid_Performance");
-//         k++;
-//     }
-//     LIKWID_MARKER_STOP("Gauss_Seidel_Likwid_Performance");
-
-//     printGaussSeidelParameters(acumItTime / (it), arrayL2Norm, output, it);
-// }
-
-// void gaussSeidel(linearSystem *linSys, int it, FILE *output) {  // Loop unroll de 4.
-//     real_t itTime, *arrayL2Norm, acumItTime;
-//     int i, aux, k = 0;
-//     acumItTime = 0.0;
-//     arrayL2Norm = (real_t *)malloc(it * sizeof(real_t));
-
-//     LIKWID_MARKER_START("Gauss_Seidel_Likwid_Performance");
-//     while (k < it) {
-//         itTime = timestamp();
-//         i = 0;
-
-//         // primeira equação fora do laço
-//         linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx])) / linSys->md[i];
-
-//         // for  ate o inicio da diagonal inferior inferior
-//         aux = linSys->nx;
-//         aux -= aux % 4;
-//         for (i = 1; i < aux; i += 4) {
-//             linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) / linSys->md[i];
-//             linSys->x[i + 1] = (linSys->b[i + 1] - (linSys->sd[i + 1] * linSys->x[i + 2]) - (linSys->ssd[i + 1] * linSys->x[i + linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i])) / linSys->md[i + 1];
-//             linSys->x[i + 2] = (linSys->b[i + 2] - (linSys->sd[i + 2] * linSys->x[i + 3]) - (linSys->ssd[i + 2] * linSys->x[i + linSys->nx + 2]) - (linSys->id[i + 2] * linSys->x[i + 1])) / linSys->md[i + 2];
-//             linSys->x[i + 3] = (linSys->b[i + 3] - (linSys->sd[i + 3] * linSys->x[i + 4]) - (linSys->ssd[i + 3] * linSys->x[i + linSys->nx + 3]) - (linSys->id[i + 3] * linSys->x[i + 2])) / linSys->md[i + 3];
-//         }
-//         for (; i < linSys->nx; i++) {
-//             linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) / linSys->md[i];
-//         }
-
-//         // equações com todas as diagonais
-//         aux = linSys->nx * linSys->ny - linSys->nx;
-//         aux -= aux % 4;
-//         for (; i < aux; i += 4) {
-//             linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->iid[i] * linSys->x[i - linSys->nx])) / linSys->md[i];
-//             linSys->x[i + 1] = (linSys->b[i + 1] - (linSys->sd[i + 1] * linSys->x[i + 2]) - (linSys->ssd[i + 1] * linSys->x[i + linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i]) - (linSys->iid[i + 1] * linSys->x[i - linSys->nx + 1])) / linSys->md[i + 1];
-//             linSys->x[i + 2] = (linSys->b[i + 2] - (linSys->sd[i + 2] * linSys->x[i + 3]) - (linSys->ssd[i + 2] * linSys->x[i + linSys->nx + 2]) - (linSys->id[i + 2] * linSys->x[i + 1]) - (linSys->iid[i + 2] * linSys->x[i - linSys->nx + 2])) / linSys->md[i + 2];
-//             linSys->x[i + 3] = (linSys->b[i + 3] - (linSys->sd[i + 3] * linSys->x[i + 4]) - (linSys->ssd[i + 3] * linSys->x[i + linSys->nx + 3]) - (linSys->id[i + 3] * linSys->x[i + 2]) - (linSys->iid[i + 3] * linSys->x[i - linSys->nx + 3])) / linSys->md[i + 3];
-//         }
-//         for (; i < linSys->nx * linSys->ny - linSys->nx; i++) {
-//             linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->iid[i] * linSys->x[i - linSys->nx])) / linSys->md[i];
-//         }
-//         // for ate o final da diagonal inferior inferior
-//         aux = linSys->nx * linSys->ny - 1;
-//         aux -= aux % 4;
-//         for (; i < aux; i += 4) {
-//             linSys->x[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->sd[i] * linSys->x[i + 1])) / linSys->md[i];
-//             linSys->x[i + 1] = (linSys->b[i + 1] - (linSys->iid[i + 1] * linSys->x[i - linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i]) - (linSys->sd[i + 1] * linSys->x[i + 2])) / linSys->md[i + 1];
-//             linSys->x[i + 2] = (linSys->b[i + 2] - (linSys->iid[i + 2] * linSys->x[i - linSys->nx + 2]) - (linSys->id[i + 2] * linSys->x[i + 1]) - (linSys->sd[i + 2] * linSys->x[i + 3])) / linSys->md[i + 2];
-//             linSys->x[i + 3] = (linSys->b[i + 3] - (linSys->iid[i + 3] * linSys->x[i - linSys->nx + 3]) - (linSys->id[i + 3] * linSys->x[i + 2]) - (linSys->sd[i + 3] * linSys->x[i + 4])) / linSys->md[i + 3];
-//         }
-//         for (; i < linSys->nx * linSys->ny - 1; i++) {
-//             linSys->x[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->sd[i] * linSys->x[i + 1])) / linSys->md[i];
-//         }
-//         // ultima equação fora do laço
-//         linSys->x[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) / linSys->md[i];
-
-//         acumItTime += timestamp() - itTime;
-//         LIKWID_MARKER_START("L2_Norm_Likwid_Performance");
-//         arrayL2Norm[k] = l2Norm(linSys);
-//         LIKWID_MARKER_STOP("L2_Norm_Likwid_Performance");
-//         k++;
-//     }
-//     LIKWID_MARKER_STOP("Gauss_Seidel_Likwid_Performance");
-
-//     printGaussSeidelParameters(acumItTime / (it), arrayL2Norm, output, it);
-// }
+#include <fcntl.h>
+#include <math.h>
+#include <omp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+#include "instrumentation.h"
+#include "partialDifferential.h"
+#include "partialDifferential3d.h"
+#include "problems.h"
+#include "simdKernels.h"
+#include "utils.h"
+
+#define SOR_ESTIMATE_CHECKS 20  // Residual evaluations used to estimate the SOR relaxation factor.
+#define WAVEFRONT_BLOCK_ROWS 4  // Rows per block of the temporally blocked sweep.
+#define MG_SMOOTHING_SWEEPS 2   // Pre and post smoothing sweeps of the multigrid cycles.
+#define MG_COARSEST_SWEEPS 50   // Sweeps that solve the coarsest multigrid level.
+#define ARENA_ALIGNMENT 64  // Alignment of each array of the linear system (cache line, AVX-512).
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)  // Alignment of the arena when huge pages are requested.
+#define PIPELINE_MIN_COLUMNS 64  // Minimum width of the column block of a thread of the pipelined sweep.
+#define PIPELINE_STRIDE 8        // Distance between the progress counters of the pipeline (one cache line).
+#define PIPELINE_SPINS 4096      // Polls of a progress counter before the waiting thread yields its core.
+
+// Residual region of the solve in progress, set by iterativeSolve() (NULL outside of it).
+static timerRegion *residualTimer = NULL;
+
+// Region that also receives the chunk times of the following solves, set by setChunkTimer() (NULL disables).
+static timerRegion *chunkTimer = NULL;
+
+/**
+ * @brief Function to return the bytes of one array of the arena, rounded up to ARENA_ALIGNMENT.
+ *
+ * @param n Number of elements.
+ * @return size_t
+ */
+static size_t arenaSlot(size_t n) {
+    size_t bytes = n * sizeof(real_t);
+
+    return (bytes + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+}
+
+/**
+ * @brief Function to allocate space in memory.
+ *
+ * All arrays live in a single arena, each one starting on an ARENA_ALIGNMENT boundary. The arena is zeroed by the
+ * OpenMP threads with the same static row partition of the threaded kernels, so with first touch placement each thread
+ * finds its rows on its own NUMA node. With huge pages the arena is aligned to HUGE_PAGE_SIZE and advised for
+ * transparent huge pages; the placement then has the granularity of 2MB.
+ *
+ * @param nx Number of points in x.
+ * @param ny Number of points in y.
+ * @param matrixFree If set only "b" and "x" are allocated and the kernels use the stencil coefficients.
+ * @param hugePages If set the arena is backed by 2MB pages when the system allows it.
+ * @return linearSystem Linear system struct.
+ */
+linearSystem initLinearSystem(int nx, int ny, int matrixFree, int hugePages) {
+    linearSystem linSys;
+    size_t slot = arenaSlot((size_t)nx * ny), size;
+    int nArrays = matrixFree ? 2 : 7;
+    real_t **arrays[] = {&linSys.b, &linSys.x, &linSys.ssd, &linSys.sd, &linSys.md, &linSys.id, &linSys.iid};
+    char *arena;
+
+    size = nArrays * slot;
+    if (hugePages) {
+        size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    }
+
+    if (posix_memalign(&linSys.arena, hugePages ? HUGE_PAGE_SIZE : ARENA_ALIGNMENT, size) != 0) {
+        linSys.arena = NULL;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (hugePages && linSys.arena) {
+        madvise(linSys.arena, size, MADV_HUGEPAGE);
+    }
+#endif
+
+    arena = (char *)linSys.arena;
+    linSys.ssd = linSys.sd = linSys.md = linSys.id = linSys.iid = NULL;
+
+    for (int a = 0; a < nArrays; a++) {
+        *arrays[a] = arena ? (real_t *)(arena + a * slot) : NULL;
+    }
+
+    // First touch: each thread zeroes the rows it sweeps.
+    if (arena) {
+#pragma omp parallel for schedule(static)
+        for (int j = 0; j < ny; j++) {
+            for (int a = 0; a < nArrays; a++) {
+                memset(*arrays[a] + (size_t)j * nx, 0, nx * sizeof(real_t));
+            }
+        }
+    }
+
+    linSys.matrixFree = matrixFree;
+    linSys.prob = DEFAULT_PROBLEM;
+    linSys.nx = nx;
+    linSys.ny = ny;
+    linSys.nz = 0;
+
+    return linSys;
+}
+
+/**
+ * @brief Function to free the arena of a linear system.
+ *
+ * @param linSys Linear system struct.
+ */
+void freeLinearSystem(linearSystem *linSys) {
+    free(linSys->arena);
+
+    linSys->arena = NULL;
+    linSys->ssd = linSys->sd = linSys->md = linSys->id = linSys->iid = linSys->b = linSys->x = NULL;
+}
+
+/**
+ * @brief Function to return the main diagonal entry of row k, from the arrays or from the stencil coefficients.
+ *
+ * @param linSys Linear system struct.
+ * @param k Row of the system.
+ * @return real_t
+ */
+static inline real_t mainDiagonal(const linearSystem *linSys, int k) {
+    return linSys->matrixFree ? linSys->coef.md : linSys->md[k];
+}
+
+/**
+ * @brief Function to compute the product of row k without the main diagonal by "x", for the grid point (i, j).
+ *
+ * Works in both storage modes; the matrix-free test is loop invariant so the compiler hoists it out of the callers loops.
+ *
+ * @param linSys Linear system struct.
+ * @param x Vector (usually linSys->x).
+ * @param k Row of the system (j * nx + i).
+ * @param i Column of the grid point.
+ * @param j Row of the grid point.
+ * @return real_t
+ */
+static inline real_t offDiagonalProduct(const linearSystem *linSys, const real_t *x, int k, int i, int j) {
+    int nx = linSys->nx;
+    real_t sum = 0.0;
+
+    if (linSys->matrixFree) {
+        const stencil *c = &linSys->coef;
+
+        if (i > 0) {
+            sum += c->id * x[k - 1];
+        }
+        if (i < nx - 1) {
+            sum += c->sd * x[k + 1];
+        }
+        if (j > 0) {
+            sum += c->iid * x[k - nx];
+        }
+        if (j < linSys->ny - 1) {
+            sum += c->ssd * x[k + nx];
+        }
+    } else {
+        if (i > 0) {
+            sum += linSys->id[k] * x[k - 1];
+        }
+        if (i < nx - 1) {
+            sum += linSys->sd[k] * x[k + 1];
+        }
+        if (j > 0) {
+            sum += linSys->iid[k] * x[k - nx];
+        }
+        if (j < linSys->ny - 1) {
+            sum += linSys->ssd[k] * x[k + nx];
+        }
+    }
+
+    return sum;
+}
+
+/**
+ * @brief Function to return the mesh spacing of linSys: its nx by ny interior points split the domain of the problem.
+ *
+ * @param linSys Linear system struct.
+ * @param hx Spacing in x.
+ * @param hy Spacing in y.
+ */
+void gridSpacing(const linearSystem *linSys, real_t *hx, real_t *hy) {
+    *hx = (linSys->prob->x1 - linSys->prob->x0) / (linSys->nx + 1);
+    *hy = (linSys->prob->y1 - linSys->prob->y0) / (linSys->ny + 1);
+}
+
+/**
+ * @brief Function to set the stencil coefficients (and the diagonal arrays, if allocated) for the mesh spacing of linSys.
+ *
+ * The equation of the problem is multiplied by 2 * hx^2 * hy^2, with centered differences for all the derivatives.
+ *
+ * @param linSys Linear system struct.
+ */
+void setStencil(linearSystem *linSys) {
+    const problem *prob = linSys->prob;
+    real_t hx, hy, sqrHx, sqrHy;
+
+    gridSpacing(linSys, &hx, &hy);
+
+    sqrHx = hx * hx;
+    sqrHy = hy * hy;
+
+    // ------------------------------------------------ STENCIL COEFFICIENTS ------------------------------------------------
+
+    linSys->coef.ssd = sqrHx * (prob->cy * hy - 2 * prob->kyy);
+    linSys->coef.sd = sqrHy * (prob->cx * hx - 2 * prob->kxx);
+    linSys->coef.md = 4 * (prob->kxx * sqrHy + prob->kyy * sqrHx + prob->k0 / 2 * sqrHx * sqrHy);
+    linSys->coef.id = sqrHy * (-2 * prob->kxx - prob->cx * hx);
+    linSys->coef.iid = sqrHx * (-2 * prob->kyy - prob->cy * hy);
+
+    // ------------------------------------------------ FILL A DIAGONAL MATRIX ------------------------------------------------
+
+    if (!linSys->matrixFree) {
+        // Superior superior diagonal.
+        for (int i = 0; i < (linSys->nx * linSys->ny) - linSys->nx; i++) {
+            linSys->ssd[i] = linSys->coef.ssd;
+        }
+
+        // Superior diagonal.
+        for (int k = 0; k < linSys->nx * linSys->ny; k++) {
+            if ((k + 1) % linSys->nx != 0) {
+                linSys->sd[k] = linSys->coef.sd;
+            }
+        }
+
+        // Main diagonal
+        for (int i = 0; i < linSys->nx * linSys->ny; i++) {
+            linSys->md[i] = linSys->coef.md;
+        }
+
+        // Inferior diagonal
+        for (int k = 0; k < linSys->nx * linSys->ny; k++) {
+            if (k % linSys->nx != 0) {
+                linSys->id[k] = linSys->coef.id;
+            }
+        }
+
+        // Inferior inferior diagonal
+        for (int i = linSys->nx; i < linSys->nx * linSys->ny; i++) {
+            linSys->iid[i] = linSys->coef.iid;
+        }
+    }
+}
+
+/**
+ * @brief Function to fill rows j0 to j0 + rows - 1 of the right-hand side, for the mesh and stencil of linSys.
+ *
+ * Problems with a specialized assembly use it; the generic one evaluates the source at every point and moves the known
+ * boundary values of the neighbors on the edges of the mesh to the right-hand side.
+ *
+ * @param linSys Linear system struct (nx, ny, coef and prob are used).
+ * @param b Right-hand side of the rows (rows * nx).
+ * @param j0 First grid row.
+ * @param rows Number of rows.
+ */
+void setRightHandSide(const linearSystem *linSys, real_t *b, int j0, int rows) {
+    const problem *prob = linSys->prob;
+    int nx = linSys->nx, ny = linSys->ny;
+    real_t hx, hy;
+
+    if (prob->rightHandSide) {
+        prob->rightHandSide(linSys, b, j0, rows);
+        return;
+    }
+
+    gridSpacing(linSys, &hx, &hy);
+
+    real_t scale = 2 * (hx * hx) * (hy * hy);
+
+#pragma omp parallel for schedule(static)
+    for (int j = 0; j < rows; j++) {
+        real_t *row = b + j * nx, y = prob->y0 + (j0 + j + 1) * hy;
+
+        for (int i = 0; i < nx; i++) {
+            row[i] = scale * prob->source(prob->x0 + (i + 1) * hx, y);
+        }
+
+        row[0] -= prob->left(y) * linSys->coef.id;
+        row[nx - 1] -= prob->right(y) * linSys->coef.sd;
+    }
+
+    if (j0 == 0) {
+        for (int i = 0; i < nx; i++) {
+            b[i] -= prob->bottom(prob->x0 + (i + 1) * hx) * linSys->coef.iid;
+        }
+    }
+
+    if (j0 + rows == ny) {
+        real_t *upper = b + (rows - 1) * nx;
+
+        for (int i = 0; i < nx; i++) {
+            upper[i] -= prob->top(prob->x0 + (i + 1) * hx) * linSys->coef.ssd;
+        }
+    }
+}
+
+/**
+ * @brief Set the Linear System object
+ *
+ * @param linSys Linear system struct.
+ */
+void setLinearSystem(linearSystem *linSys) {
+    setStencil(linSys);
+
+    // ------------------------------------------------ FILL B ARRAY ------------------------------------------------
+
+    setRightHandSide(linSys, linSys->b, 0, linSys->ny);
+}
+
+/**
+ * @brief Function to sum the squared residuals of grid row j without the diagonal arrays.
+ *
+ * The first and last columns skip the "id" and "sd" terms and the first and last rows skip the "iid" and "ssd" terms,
+ * which is where the diagonal arrays hold zeros. The terms are subtracted in the same order as residualRow() so both
+ * modes produce the same values, unless the problem has its own kernel for the interior points.
+ *
+ * @param linSys Linear system struct.
+ * @param j Grid row.
+ * @return real_t Sum of the squared residuals of the row.
+ */
+static inline real_t residualRowMatrixFree(const linearSystem *linSys, int j) {
+    int nx = linSys->nx, k = j * nx, end = k + nx - 1;
+    const real_t *x = linSys->x, *b = linSys->b;
+    stencil c = linSys->coef;
+    real_t (*interior)(const linearSystem *, int, int) = kernels.residualSquaresStencil;
+    real_t r, result = 0.0;
+
+    if (linSys->prob && linSys->prob->residualSquaresStencil) {
+        interior = linSys->prob->residualSquaresStencil;
+    }
+
+    if (j == 0) {
+        // First row (no inferior inferior diagonal).
+        r = (b[k] - (c.sd * x[k + 1]) - (c.ssd * x[k + nx])) - c.md * x[k];
+        result += r * r;
+        for (k++; k < end; k++) {
+            r = (b[k] - (c.sd * x[k + 1]) - (c.ssd * x[k + nx]) - (c.id * x[k - 1])) - c.md * x[k];
+            result += r * r;
+        }
+        r = (b[k] - (c.ssd * x[k + nx]) - (c.id * x[k - 1])) - c.md * x[k];
+    } else if (j < linSys->ny - 1) {
+        // Rows with all the diagonals.
+        r = (b[k] - (c.sd * x[k + 1]) - (c.ssd * x[k + nx]) - (c.iid * x[k - nx])) - c.md * x[k];
+        result += r * r + interior(linSys, k + 1, end);
+        k = end;
+        r = (b[k] - (c.ssd * x[k + nx]) - (c.id * x[k - 1]) - (c.iid * x[k - nx])) - c.md * x[k];
+    } else {
+        // Last row (no superior superior diagonal).
+        r = (b[k] - (c.iid * x[k - nx]) - (c.sd * x[k + 1])) - c.md * x[k];
+        result += r * r;
+        for (k++; k < end; k++) {
+            r = (b[k] - (c.iid * x[k - nx]) - (c.id * x[k - 1]) - (c.sd * x[k + 1])) - c.md * x[k];
+            result += r * r;
+        }
+        r = (b[k] - (c.iid * x[k - nx]) - (c.id * x[k - 1])) - c.md * x[k];
+    }
+
+    return result + r * r;
+}
+
+/**
+ * @brief Function to sum the squared residuals of grid row j.
+ *
+ * @param linSys Linear system struct.
+ * @param j Grid row.
+ * @return real_t Sum of the squared residuals of the row.
+ */
+static inline real_t residualRow(const linearSystem *linSys, int j) {
+    if (linSys->matrixFree) {
+        return residualRowMatrixFree(linSys, j);
+    }
+
+    int nx = linSys->nx, k = j * nx, end = k + nx;
+    const real_t *x = linSys->x, *b = linSys->b;
+    const real_t *ssd = linSys->ssd, *sd = linSys->sd, *md = linSys->md, *id = linSys->id, *iid = linSys->iid;
+    real_t r, result = 0.0;
+
+    if (j == 0) {
+        // First equation outside the loop.
+        r = (b[k] - (sd[k] * x[k + 1]) - (ssd[k] * x[k + nx])) - md[k] * x[k];
+        result += r * r;
+
+        // Up to the start of the inferior inferior diagonal.
+        for (k++; k < end; k++) {
+            r = (b[k] - (sd[k] * x[k + 1]) - (ssd[k] * x[k + nx]) - (id[k] * x[k - 1])) - md[k] * x[k];
+            result += r * r;
+        }
+    } else if (j < linSys->ny - 1) {
+        // Equations with all the diagonals.
+        result = kernels.residualSquaresDiagonals(linSys, k, end);
+    } else {
+        // Up to the end of the inferior inferior diagonal.
+        for (; k < end - 1; k++) {
+            r = (b[k] - (iid[k] * x[k - nx]) - (id[k] * x[k - 1]) - (sd[k] * x[k + 1])) - md[k] * x[k];
+            result += r * r;
+        }
+
+        // Last equation outside the loop.
+        r = (b[k] - (iid[k] * x[k - nx]) - (id[k] * x[k - 1])) - md[k] * x[k];
+        result += r * r;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Function to calculate L2 norm.
+ *
+ * The squares are accumulated row by row while the residual is computed, so no temporary array is needed. Each row is
+ * summed on its own and then added to the total, so the last bits differ from a single running sum over all points.
+ * The evaluation is the "L2_Norm_Likwid_Performance" region.
+ *
+ * @param linSys Linear system struct.
+ * @return real_t
+ */
+real_t l2Norm(linearSystem *linSys) {
+    real_t result = 0.0, start = timestamp();
+
+    LIKWID_MARKER_START("L2_Norm_Likwid_Performance");
+    for (int j = 0; j < linSys->ny; j++) {
+        result += residualRow(linSys, j);
+    }
+    LIKWID_MARKER_STOP("L2_Norm_Likwid_Performance");
+
+    if (residualTimer) {
+        addTimerSample(residualTimer, timestamp() - start);
+    }
+
+    return sqrt(result);
+}
+
+// real_t l2Norm(linearSystem *linSys) {  // Loop unroll de 2.
+//     real_t *temp = (real_t *)malloc((linSys->nx * linSys->ny) * sizeof(real_t));
+//     int aux, i = 0;
+
+//     // primeira equação fora do laço
+//     temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx])) - linSys->md[i] * linSys->x[i];
+
+//     // for  ate o inicio da diagonal inferior inferior
+//     aux = linSys->nx;
+//     aux -= aux % 2;
+//     for (i = 1; i < aux; i += 2) {
+//         temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) - linSys->md[i] * linSys->x[i];
+//         temp[i + 1] = (linSys->b[i + 1] - (linSys->sd[i + 1] * linSys->x[i + 2]) - (linSys->ssd[i + 1] * linSys->x[i + linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i])) - linSys->md[i + 1] * linSys->x[i + 1];
+//     }
+//     for (; i < linSys->nx; i++) {
+//         temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) - linSys->md[i] * linSys->x[i];
+//     }
+
+//     // equações com todas as diagonais
+//     aux = linSys->nx * linSys->ny - linSys->nx;
+//     aux -= aux % 2;
+//     for (; i < aux; i += 2) {
+//         temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->iid[i] * linSys->x[i - linSys->nx])) - linSys->md[i] * linSys->x[i];
+//         temp[i + 1] = (linSys->b[i + 1] - (linSys->sd[i + 1] * linSys->x[i + 2]) - (linSys->ssd[i + 1] * linSys->x[i + linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i]) - (linSys->iid[i + 1] * linSys->x[i - linSys->nx + 1])) - linSys->md[i + 1] * linSys->x[i + 1];
+//     }
+//     for (; i < linSys->nx * linSys->ny - linSys->nx; i++) {
+//         temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->iid[i] * linSys->x[i - linSys->nx])) - linSys->md[i] * linSys->x[i];
+//     }
+
+//     // for ate o final da diagonal inferior inferior
+//     aux = linSys->nx * linSys->ny - 1;
+//     aux -= aux % 2;
+//     for (; i < aux; i += 2) {
+//         temp[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->sd[i] * linSys->x[i + 1])) - linSys->md[i] * linSys->x[i];
+//         temp[i + 1] = (linSys->b[i + 1] - (linSys->iid[i + 1] * linSys->x[i - linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i]) - (linSys->sd[i + 1] * linSys->x[i + 2])) - linSys->md[i + 1] * linSys->x[i + 1];
+//     }
+//     for (; i < (linSys->nx * linSys->ny - 1); i++) {
+//         temp[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->sd[i] * linSys->x[i + 1])) - linSys->md[i] * linSys->x[i];
+//     }
+
+//     // ultima equação fora do laço
+//     temp[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) - linSys->md[i] * linSys->x[i];
+
+//     real_t result = 0.0;
+
+//     // raiz dos quadrados dos residuos
+//     for (i = 0; i < aux; i++) {
+//         result += temp[i] * temp[i];
+//     }
+
+//     return sqrt(result);
+// }
+
+// real_t l2Norm(linearSystem *linSys) {  // Loop unroll de 4.
+//     real_t *temp = (real_t *)malloc((linSys->nx * linSys->ny) * sizeof(real_t));
+//     int aux, i = 0;
+
+//     // primeira equação fora do laço
+//     temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx])) - linSys->md[i] * linSys->x[i];
+
+//     // for  ate o inicio da diagonal inferior inferior
+//     aux = linSys->nx;
+//     aux -= aux % 4;
+//     for (i = 1; i < aux; i += 4) {
+//         temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) - linSys->md[i] * linSys->x[i];
+//         temp[i + 1] = (linSys->b[i + 1] - (linSys->sd[i + 1] * linSys->x[i + 2]) - (linSys->ssd[i + 1] * linSys->x[i + linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i])) - linSys->md[i + 1] * linSys->x[i + 1];
+//         temp[i + 2] = (linSys->b[i + 2] - (linSys->sd[i + 2] * linSys->x[i + 3]) - (linSys->ssd[i + 2] * linSys->x[i + linSys->nx + 2]) - (linSys->id[i + 2] * linSys->x[i + 1])) - linSys->md[i + 2] * linSys->x[i + 2];
+//         temp[i + 3] = (linSys->b[i + 3] - (linSys->sd[i + 3] * linSys->x[i + 4]) - (linSys->ssd[i + 3] * linSys->x[i + linSys->nx + 3]) - (linSys->id[i + 3] * linSys->x[i + 2])) - linSys->md[i + 3] * linSys->x[i + 3];
+//     }
+//     for (; i < linSys->nx; i++) {
+//         temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) - linSys->md[i] * linSys->x[i];
+//     }
+
+//     // equações com todas as diagonais
+//     aux = linSys->nx * linSys->ny - linSys->nx;
+//     aux -= aux % 4;
+//     for (; i < aux; i += 4) {
+//         temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->iid[i] * linSys->x[i - linSys->nx])) - linSys->md[i] * linSys->x[i];
+//         temp[i + 1] = (linSys->b[i + 1] - (linSys->sd[i + 1] * linSys->x[i + 2]) - (linSys->ssd[i + 1] * linSys->x[i + linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i]) - (linSys->iid[i + 1] * linSys->x[i - linSys->nx + 1])) - linSys->md[i + 1] * linSys->x[i + 1];
+//         temp[i + 2] = (linSys->b[i + 2] - (linSys->sd[i + 2] * linSys->x[i + 3]) - (linSys->ssd[i + 2] * linSys->x[i + linSys->nx + 2]) - (linSys->id[i + 2] * linSys->x[i + 1]) - (linSys->iid[i + 2] * linSys->x[i - linSys->nx + 2])) - linSys->md[i + 2] * linSys->x[i + 2];
+//         temp[i + 3] = (linSys->b[i + 3] - (linSys->sd[i + 3] * linSys->x[i + 4]) - (linSys->ssd[i + 3] * linSys->x[i + linSys->nx + 3]) - (linSys->id[i + 3] * linSys->x[i + 2]) - (linSys->iid[i + 3] * linSys->x[i - linSys->nx + 3])) - linSys->md[i + 3] * linSys->x[i + 3];
+//     }
+//     for (; i < linSys->nx * linSys->ny - linSys->nx; i++) {
+//         temp[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->iid[i] * linSys->x[i - linSys->nx])) - linSys->md[i] * linSys->x[i];
+//     }
+
+//     // for ate o final da diagonal inferior inferior
+//     aux = linSys->nx * linSys->ny - 1;
+//     aux -= aux % 4;
+//     for (; i < aux; i += 4) {
+//         temp[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->sd[i] * linSys->x[i + 1])) - linSys->md[i] * linSys->x[i];
+//         temp[i + 1] = (linSys->b[i + 1] - (linSys->iid[i + 1] * linSys->x[i - linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i]) - (linSys->sd[i + 1] * linSys->x[i + 2])) - linSys->md[i + 1] * linSys->x[i + 1];
+//         temp[i + 2] = (linSys->b[i + 2] - (linSys->iid[i + 2] * linSys->x[i - linSys->nx + 2]) - (linSys->id[i + 2] * linSys->x[i + 1]) - (linSys->sd[i + 2] * linSys->x[i + 3])) - linSys->md[i + 2] * linSys->x[i + 2];
+//         temp[i + 3] = (linSys->b[i + 3] - (linSys->iid[i + 3] * linSys->x[i - linSys->nx + 3]) - (linSys->id[i + 3] * linSys->x[i + 2]) - (linSys->sd[i + 3] * linSys->x[i + 4])) - linSys->md[i + 3] * linSys->x[i + 3];
+//     }
+//     for (; i < (linSys->nx * linSys->ny - 1); i++) {
+//         temp[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->sd[i] * linSys->x[i + 1])) - linSys->md[i] * linSys->x[i];
+//     }
+
+//     // ultima equação fora do laço
+//     temp[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) - linSys->md[i] * linSys->x[i];
+
+//     real_t result = 0.0;
+
+//     // raiz dos quadrados dos residuos
+//     for (i = 0; i < aux; i++) {
+//         result += temp[i] * temp[i];
+//     }
+
+//     return sqrt(result);
+// }
+
+/**
+ * @brief Function to print the discretization matrix.
+ *
+ * @param linSys LinearSystem structure
+ * @param output Output file.
+ */
+void printMesh(linearSystem *linSys, FILE *output) {
+    real_t hx, hy;
+
+    gridSpacing(linSys, &hx, &hy);
+
+    if (!output) {
+        output = stdout;
+    }
+
+    int k = 0;
+
+    for (int j = 1; j <= linSys->ny; j++) {
+        for (int i = 1; i <= linSys->nx; i++) {
+            fprintf(output, "%lf %lf %lf\n", linSys->prob->x0 + i * hx, linSys->prob->y0 + j * hy, linSys->x[k++]);
+        }
+    }
+}
+
+/**
+ * @brief Function to write the whole mesh to a binary file: a meshHeader followed by the nx * ny values of "x".
+ *
+ * The file is sized with ftruncate and filled through a shared memory mapping, so the solution is copied once instead of
+ * being formatted point by point. Point k = j * nx + i is at (x0 + (i + 1) * hx, y0 + (j + 1) * hy).
+ *
+ * @param linSys LinearSystem structure
+ * @param fileName Output file name.
+ * @return int 0 on success, -1 on failure.
+ */
+int writeMeshBinary(linearSystem *linSys, const char *fileName) {
+    meshHeader header;
+    size_t dataSize = (size_t)linSys->nx * linSys->ny * sizeof(real_t);
+    size_t size = sizeof(meshHeader) + dataSize;
+    char *map;
+    int fd;
+
+    memset(&header, 0, sizeof(meshHeader));
+    memcpy(header.magic, MESH_MAGIC, sizeof(header.magic));
+    header.nx = linSys->nx;
+    header.ny = linSys->ny;
+    gridSpacing(linSys, &header.hx, &header.hy);
+    header.x0 = linSys->prob->x0;
+    header.y0 = linSys->prob->y0;
+
+    fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (ftruncate(fd, size) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    map = mmap(NULL, size, PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    memcpy(map, &header, sizeof(meshHeader));
+    memcpy(map + sizeof(meshHeader), linSys->x, dataSize);
+
+    munmap(map, size);
+    close(fd);
+
+    return 0;
+}
+
+/**
+ * @brief Function to print Gauss Seidel parameters.
+ *
+ * @param avrgTime Average time.
+ * @param arrayL2Norm Array with all L2 norms.
+ * @param arrayIt Iteration of each L2 norm.
+ * @param output Output file.
+ * @param nNorms Number of L2 norms.
+ */
+void printGaussSeidelParameters(real_t avrgTime, real_t *arrayL2Norm, int *arrayIt, FILE *output, int nNorms) {
+    fprintf(output, "###########\n");
+
+    fprintf(output, "# Tempo Método GS: %lfms\n", avrgTime);
+    fprintf(output, "#\n");
+
+    // ----------------------------------------------- L2 Norm -----------------------------------------------
+
+    fprintf(output, "# Norma L2 do Residuo\n");
+
+    for (int i = 0; i < nNorms; i++) {
+        fprintf(output, "#i = %d : %lf\n", arrayIt[i], arrayL2Norm[i]);
+    }
+
+    fprintf(output, "###########\n");
+}
+
+/**
+ * @brief Function to apply the successive over-relaxation to a Gauss Seidel update.
+ *
+ * With omega equal to 1 the Gauss Seidel value is returned untouched, so the plain method keeps its exact iterates.
+ *
+ * @param old Current value of the point.
+ * @param gs Value given by the Gauss Seidel update.
+ * @param omega Relaxation factor.
+ * @return real_t New value of the point.
+ */
+static inline real_t sorUpdate(real_t old, real_t gs, real_t omega) {
+    return omega == 1.0 ? gs : old + omega * (gs - old);
+}
+
+/**
+ * @brief Function to update columns i0 to i1 - 1 of grid row j of a lexicographic Gauss Seidel sweep without the
+ * diagonal arrays.
+ *
+ * Same edge handling and term order as residualRowMatrixFree(), so the iterates match the ones of the array sweep, unless
+ * the problem has its own kernel for the interior points of the interior rows. Every point uses the expression of its
+ * position in the full row, so splitting a row in ranges gives the same values.
+ *
+ * @param linSys Linear system struct.
+ * @param j Grid row.
+ * @param i0 First column.
+ * @param i1 One past the last column.
+ * @param omega Relaxation factor.
+ */
+static inline void gaussSeidelRangeMatrixFree(linearSystem *linSys, int j, int i0, int i1, real_t omega) {
+    int nx = linSys->nx, k = j * nx + i0, end = j * nx + i1, last = j * nx + nx - 1;
+    real_t *x = linSys->x;
+    const real_t *b = linSys->b;
+    stencil c = linSys->coef;
+    void (*interior)(linearSystem *, int, int, real_t) = linSys->prob ? linSys->prob->sweepStencil : NULL;
+
+    if (j == 0) {
+        // First row (no inferior inferior diagonal).
+        if (i0 == 0) {
+            x[k] = sorUpdate(x[k], (b[k] - (c.sd * x[k + 1]) - (c.ssd * x[k + nx])) / c.md, omega);
+            k++;
+        }
+        for (; k < end && k < last; k++) {
+            x[k] = sorUpdate(x[k], (b[k] - (c.sd * x[k + 1]) - (c.ssd * x[k + nx]) - (c.id * x[k - 1])) / c.md, omega);
+        }
+        if (end == last + 1) {
+            x[last] = sorUpdate(x[last], (b[last] - (c.ssd * x[last + nx]) - (c.id * x[last - 1])) / c.md, omega);
+        }
+    } else if (j < linSys->ny - 1) {
+        // Rows with all the diagonals.
+        if (i0 == 0) {
+            x[k] = sorUpdate(x[k], (b[k] - (c.sd * x[k + 1]) - (c.ssd * x[k + nx]) - (c.iid * x[k - nx])) / c.md, omega);
+            k++;
+        }
+        if (interior) {
+            interior(linSys, k, end < last ? end : last, omega);
+        } else {
+            for (; k < end && k < last; k++) {
+                x[k] = sorUpdate(x[k], (b[k] - (c.sd * x[k + 1]) - (c.ssd * x[k + nx]) - (c.id * x[k - 1]) - (c.iid * x[k - nx])) / c.md, omega);
+            }
+        }
+        if (end == last + 1) {
+            x[last] = sorUpdate(x[last], (b[last] - (c.ssd * x[last + nx]) - (c.id * x[last - 1]) - (c.iid * x[last - nx])) / c.md, omega);
+        }
+    } else {
+        // Last row (no superior superior diagonal).
+        if (i0 == 0) {
+            x[k] = sorUpdate(x[k], (b[k] - (c.iid * x[k - nx]) - (c.sd * x[k + 1])) / c.md, omega);
+            k++;
+        }
+        for (; k < end && k < last; k++) {
+            x[k] = sorUpdate(x[k], (b[k] - (c.iid * x[k - nx]) - (c.id * x[k - 1]) - (c.sd * x[k + 1])) / c.md, omega);
+        }
+        if (end == last + 1) {
+            x[last] = sorUpdate(x[last], (b[last] - (c.iid * x[last - nx]) - (c.id * x[last - 1])) / c.md, omega);
+        }
+    }
+}
+
+/**
+ * @brief Function to update columns i0 to i1 - 1 of grid row j of a lexicographic Gauss Seidel sweep.
+ *
+ * The first and last columns of the grid row are updated on their own, without the "id" and "sd" terms, which would
+ * read the last point of the previous grid row and the first point of the next one with a zero coefficient. So a range
+ * only reads its own grid row and the rows above and below it, never another range of a neighbouring grid row, which the
+ * pipelined sweep relies on. The edge handling and term order are the ones of gaussSeidelRangeMatrixFree().
+ *
+ * @param linSys Linear system struct.
+ * @param j Grid row.
+ * @param i0 First column.
+ * @param i1 One past the last column.
+ * @param omega Relaxation factor.
+ */
+static inline void gaussSeidelRange(linearSystem *linSys, int j, int i0, int i1, real_t omega) {
+    if (linSys->matrixFree) {
+        gaussSeidelRangeMatrixFree(linSys, j, i0, i1, omega);
+        return;
+    }
+
+    int nx = linSys->nx, k = j * nx + i0, end = j * nx + i1, last = j * nx + nx - 1;
+    real_t *x = linSys->x;
+    const real_t *b = linSys->b;
+    const real_t *ssd = linSys->ssd, *sd = linSys->sd, *md = linSys->md, *id = linSys->id, *iid = linSys->iid;
+
+    if (j == 0) {
+        // First row (no inferior inferior diagonal).
+        if (i0 == 0) {
+            x[k] = sorUpdate(x[k], (b[k] - (sd[k] * x[k + 1]) - (ssd[k] * x[k + nx])) / md[k], omega);
+            k++;
+        }
+        for (; k < end && k < last; k++) {
+            x[k] = sorUpdate(x[k], (b[k] - (sd[k] * x[k + 1]) - (ssd[k] * x[k + nx]) - (id[k] * x[k - 1])) / md[k], omega);
+        }
+        if (end == last + 1) {
+            x[last] = sorUpdate(x[last], (b[last] - (ssd[last] * x[last + nx]) - (id[last] * x[last - 1])) / md[last], omega);
+        }
+    } else if (j < linSys->ny - 1) {
+        // Rows with all the diagonals.
+        if (i0 == 0) {
+            x[k] = sorUpdate(x[k], (b[k] - (sd[k] * x[k + 1]) - (ssd[k] * x[k + nx]) - (iid[k] * x[k - nx])) / md[k], omega);
+            k++;
+        }
+        for (; k < end && k < last; k++) {
+            x[k] = sorUpdate(x[k], (b[k] - (sd[k] * x[k + 1]) - (ssd[k] * x[k + nx]) - (id[k] * x[k - 1]) - (iid[k] * x[k - nx])) / md[k], omega);
+        }
+        if (end == last + 1) {
+            x[last] = sorUpdate(x[last], (b[last] - (ssd[last] * x[last + nx]) - (id[last] * x[last - 1]) - (iid[last] * x[last - nx])) / md[last], omega);
+        }
+    } else {
+        // Last row (no superior superior diagonal).
+        if (i0 == 0) {
+            x[k] = sorUpdate(x[k], (b[k] - (iid[k] * x[k - nx]) - (sd[k] * x[k + 1])) / md[k], omega);
+            k++;
+        }
+        for (; k < end && k < last; k++) {
+            x[k] = sorUpdate(x[k], (b[k] - (iid[k] * x[k - nx]) - (id[k] * x[k - 1]) - (sd[k] * x[k + 1])) / md[k], omega);
+        }
+        if (end == last + 1) {
+            x[last] = sorUpdate(x[last], (b[last] - (iid[last] * x[last - nx]) - (id[last] * x[last - 1])) / md[last], omega);
+        }
+    }
+}
+
+/**
+ * @brief Function to update grid row j of a lexicographic Gauss Seidel sweep.
+ *
+ * @param linSys Linear system struct.
+ * @param j Grid row.
+ * @param omega Relaxation factor.
+ */
+static inline void gaussSeidelRow(linearSystem *linSys, int j, real_t omega) {
+    gaussSeidelRange(linSys, j, 0, linSys->nx, omega);
+}
+
+/**
+ * @brief Function to do one lexicographic Gauss Seidel sweep and return the L2 norm of the updated residual.
+ *
+ * The residual of row j - 1 only depends on rows j - 2, j - 1 and j, so it is final as soon as row j is updated and is
+ * computed right away, while those rows are still in cache. The result is the same as a full sweep followed by l2Norm(),
+ * whose row by row order it keeps. There is no separate residual pass, so the "L2_Norm_Likwid_Performance" region is
+ * not entered and the residual is part of the "Gauss_Seidel_Likwid_Performance" one.
+ *
+ * @param linSys Linear system struct.
+ * @param omega Relaxation factor.
+ * @return real_t L2 norm of the residual after the sweep.
+ */
+static real_t gaussSeidelSweepResidual(linearSystem *linSys, real_t omega) {
+    real_t result = 0.0;
+
+    gaussSeidelRow(linSys, 0, omega);
+
+    for (int j = 1; j < linSys->ny; j++) {
+        gaussSeidelRow(linSys, j, omega);
+        result += residualRow(linSys, j - 1);
+    }
+
+    result += residualRow(linSys, linSys->ny - 1);
+
+    return sqrt(result);
+}
+
+/**
+ * @brief Function to do one lexicographic Gauss Seidel sweep.
+ *
+ * @param linSys Linear system struct.
+ * @param omega Relaxation factor.
+ */
+static void gaussSeidelSweep(linearSystem *linSys, real_t omega) {
+    for (int j = 0; j < linSys->ny; j++) {
+        gaussSeidelRow(linSys, j, omega);
+    }
+}
+
+/**
+ * @brief Function to do nSweeps lexicographic Gauss Seidel sweeps, the last one fused with the residual.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param data Method data (unused).
+ * @param nSweeps Number of sweeps.
+ * @return real_t L2 norm of the residual after the last sweep.
+ */
+static real_t gaussSeidelSweeps(linearSystem *linSys, const solverOptions *opts, void *data, int nSweeps) {
+    if (opts->asyncResidual) {
+        for (int t = 0; t < nSweeps; t++) {
+            gaussSeidelSweep(linSys, opts->omega);
+        }
+
+        return 0.0;
+    }
+
+    for (int t = 1; t < nSweeps; t++) {
+        gaussSeidelSweep(linSys, opts->omega);
+    }
+
+    return gaussSeidelSweepResidual(linSys, opts->omega);
+}
+
+// Shared state of the pipelined lexicographic sweeps.
+typedef struct pipeline {
+    long *progress;       // Rows finished by each thread in the current call, PIPELINE_STRIDE apart.
+    real_t *rowResidual;  // Sum of the squared residuals of each row.
+    int nThreads;         // Threads of the pipeline, each one owns a block of columns.
+} pipeline;
+
+/**
+ * @brief Function to spin until a progress counter of the pipeline reaches target.
+ *
+ * @param counter Progress counter of another thread.
+ * @param target Value to wait for.
+ */
+static inline void waitProgress(long *counter, long target) {
+    for (int spins = 0; __atomic_load_n(counter, __ATOMIC_ACQUIRE) < target; spins++) {
+        if (spins == PIPELINE_SPINS) {
+            sched_yield();
+            spins = 0;
+        }
+    }
+}
+
+/**
+ * @brief Function to do nSweeps lexicographic Gauss Seidel sweeps with the columns split across a pipeline of threads.
+ *
+ * Thread t owns a block of columns and updates it row by row. Its first point reads the last point of block t - 1 in
+ * the same row, which must already be updated, and its last point reads the first point of block t + 1, which must not
+ * be updated yet in this sweep but must be in the previous one. So thread t starts row j of sweep s once thread t - 1
+ * has finished that row and thread t + 1 has finished row j of sweep s - 1, each thread trailing its left neighbor by
+ * one row. Every point then reads the same values as in the serial order, and the iterates are bitwise the ones of
+ * gaussSeidel(). A range never reads another block of a neighbouring grid row (gaussSeidelRange() updates the row
+ * edges on their own), so these two handshakes order every read of another block. The row residuals are computed in
+ * parallel and added in row order, as in the fused serial kernel.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param data Pipeline struct.
+ * @param nSweeps Number of sweeps.
+ * @return real_t L2 norm of the residual after the last sweep.
+ */
+static real_t pipelinedSweeps(linearSystem *linSys, const solverOptions *opts, void *data, int nSweeps) {
+    pipeline *pl = (pipeline *)data;
+    int nx = linSys->nx, ny = linSys->ny;
+    real_t result = 0.0, start;
+
+    for (int t = 0; t < pl->nThreads; t++) {
+        pl->progress[t * PIPELINE_STRIDE] = 0;
+    }
+
+#pragma omp parallel num_threads(pl->nThreads)
+    {
+        int t = omp_get_thread_num(), n = omp_get_num_threads();
+        int i0 = (int)((long)t * nx / n), i1 = (int)((long)(t + 1) * nx / n);
+        long *mine = &pl->progress[t * PIPELINE_STRIDE];
+        long *left = t > 0 ? mine - PIPELINE_STRIDE : NULL, *right = t < n - 1 ? mine + PIPELINE_STRIDE : NULL;
+
+        for (long row = 0; row < (long)nSweeps * ny; row++) {
+            if (left) {
+                waitProgress(left, row + 1);
+            }
+            if (right) {
+                waitProgress(right, row + 1 - ny);
+            }
+
+            gaussSeidelRange(linSys, row % ny, i0, i1, opts->omega);
+            __atomic_store_n(mine, row + 1, __ATOMIC_RELEASE);
+        }
+    }
+
+    if (opts->asyncResidual) {
+        return 0.0;
+    }
+
+    start = timestamp();
+
+#pragma omp parallel for schedule(static)
+    for (int j = 0; j < ny; j++) {
+        pl->rowResidual[j] = residualRow(linSys, j);
+    }
+
+    for (int j = 0; j < ny; j++) {
+        result += pl->rowResidual[j];
+    }
+
+    if (residualTimer) {
+        addTimerSample(residualTimer, timestamp() - start);
+    }
+
+    return sqrt(result);
+}
+
+/**
+ * @brief Function to do depth lexicographic Gauss Seidel sweeps in a single pass over memory.
+ *
+ * The rows are grouped in blocks of WAVEFRONT_BLOCK_ROWS rows. At wavefront step s, sweep t updates block s - t, for t
+ * in increasing order. Sweep t + 1 only touches block B after sweep t has finished block B + 1, and sweep t reads block
+ * B before sweep t + 1 overwrites it, so every point sees exactly the values of the lexicographic order and the result
+ * is the same as depth calls of gaussSeidelSweep(). Only depth + 1 blocks are live at a time, so for large grids each
+ * row is loaded from memory once per pass instead of once per sweep.
+ *
+ * @param linSys Linear system struct.
+ * @param depth Number of sweeps of the pass.
+ * @param omega Relaxation factor.
+ * @param residual If not NULL, receives the sum of the squared residuals after the last sweep.
+ */
+static void wavefrontPass(linearSystem *linSys, int depth, real_t omega, real_t *residual) {
+    int nBlocks = (linSys->ny + WAVEFRONT_BLOCK_ROWS - 1) / WAVEFRONT_BLOCK_ROWS;
+    int block, j, jEnd;
+
+    for (int s = 0; s < nBlocks + depth - 1; s++) {
+        for (int t = 0; t < depth; t++) {
+            block = s - t;
+
+            if (block < 0 || block >= nBlocks) {
+                continue;
+            }
+
+            jEnd = (block + 1) * WAVEFRONT_BLOCK_ROWS < linSys->ny ? (block + 1) * WAVEFRONT_BLOCK_ROWS : linSys->ny;
+
+            for (j = block * WAVEFRONT_BLOCK_ROWS; j < jEnd; j++) {
+                gaussSeidelRow(linSys, j, omega);
+            }
+
+            // The previous block is final once the last sweep has updated this one.
+            if (residual && t == depth - 1 && block > 0) {
+                for (j = (block - 1) * WAVEFRONT_BLOCK_ROWS; j < block * WAVEFRONT_BLOCK_ROWS; j++) {
+                    *residual += residualRow(linSys, j);
+                }
+            }
+        }
+    }
+
+    if (residual) {
+        for (j = (nBlocks - 1) * WAVEFRONT_BLOCK_ROWS; j < linSys->ny; j++) {
+            *residual += residualRow(linSys, j);
+        }
+    }
+}
+
+/**
+ * @brief Function to do nSweeps lexicographic Gauss Seidel sweeps in wavefront passes of opts->depth sweeps.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param data Method data (unused).
+ * @param nSweeps Number of sweeps.
+ * @return real_t L2 norm of the residual after the last sweep.
+ */
+static real_t wavefrontSweeps(linearSystem *linSys, const solverOptions *opts, void *data, int nSweeps) {
+    real_t result = 0.0;
+    int depth;
+
+    while (nSweeps > 0) {
+        depth = nSweeps < opts->depth ? nSweeps : opts->depth;
+        nSweeps -= depth;
+
+        wavefrontPass(linSys, depth, opts->omega, nSweeps == 0 ? &result : NULL);
+    }
+
+    return sqrt(result);
+}
+
+/**
+ * @brief Function to update every point of one color of the red-black ordering.
+ *
+ * Points with (i + j) even are red (color 0) and points with (i + j) odd are black (color 1). A point only depends on
+ * neighbours of the other color, so the rows of one color can be updated by different threads at the same time.
+ *
+ * @param linSys Linear system struct.
+ * @param color Color to be updated (0 red, 1 black).
+ * @param omega Relaxation factor.
+ */
+static void redBlackColorSweep(linearSystem *linSys, int color, real_t omega) {
+    int nx = linSys->nx, ny = linSys->ny;
+
+#pragma omp parallel for schedule(static)
+    for (int j = 0; j < ny; j++) {
+        for (int i = (j + color) % 2; i < nx; i += 2) {
+            int k = j * nx + i;
+
+            linSys->x[k] = sorUpdate(linSys->x[k], (linSys->b[k] - offDiagonalProduct(linSys, linSys->x, k, i, j)) / mainDiagonal(linSys, k), omega);
+        }
+    }
+}
+
+/**
+ * @brief Function to do nSweeps red-black Gauss Seidel sweeps.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param data Method data (unused).
+ * @param nSweeps Number of sweeps.
+ * @return real_t L2 norm of the residual after the last sweep.
+ */
+static real_t redBlackSweeps(linearSystem *linSys, const solverOptions *opts, void *data, int nSweeps) {
+    for (int t = 0; t < nSweeps; t++) {
+        redBlackColorSweep(linSys, 0, opts->omega);
+        redBlackColorSweep(linSys, 1, opts->omega);
+    }
+
+    return l2Norm(linSys);
+}
+
+// Location of the points of a fine grid dimension on the coarse one, the tables of the restriction and prolongation.
+typedef struct gridTransfer {
+    int *idx;           // Coarse index of each fine point, it lies between idx and idx + 1 (nFine).
+    real_t *weight;     // Interpolation weight of idx + 1 (nFine).
+    int *first, *end;   // Fine points that interpolate from each coarse point, first to end - 1 (nCoarse).
+    real_t *weightSum;  // Sum of the weights of those fine points (nCoarse).
+} gridTransfer;
+
+// Multigrid hierarchy, levels[0] shares its arrays with the system being solved and the others are matrix-free.
+typedef struct multigrid {
+    linearSystem *levels;     // Systems from the finest to the coarsest grid.
+    real_t **residual;        // Residual workspace of each level.
+    gridTransfer *transferX;  // Transfer between level l and l + 1 in x (nLevels - 1).
+    gridTransfer *transferY;  // Transfer between level l and l + 1 in y (nLevels - 1).
+    int nLevels;
+} multigrid;
+
+/**
+ * @brief Function to compute y = A v for the pentadiagonal system, split across OpenMP threads.
+ *
+ * The interior of the grid goes through the SIMD kernels; in array mode whole interior rows do, since the diagonals
+ * already hold zeros at the edges.
+ *
+ * @param linSys Linear system struct.
+ * @param v Vector.
+ * @param y Result.
+ */
+static void matrixVectorProduct(const linearSystem *linSys, const real_t *v, real_t *y) {
+    int nx = linSys->nx, ny = linSys->ny;
+
+#pragma omp parallel for schedule(static)
+    for (int j = 0; j < ny; j++) {
+        if (j > 0 && j < ny - 1 && !linSys->matrixFree) {
+            kernels.stencilProductDiagonals(linSys, v, y, j * nx, (j + 1) * nx);
+        } else if (j > 0 && j < ny - 1) {
+            y[j * nx] = mainDiagonal(linSys, j * nx) * v[j * nx] + offDiagonalProduct(linSys, v, j * nx, 0, j);
+            kernels.stencilProductStencil(linSys, v, y, j * nx + 1, (j + 1) * nx - 1);
+            y[(j + 1) * nx - 1] = mainDiagonal(linSys, (j + 1) * nx - 1) * v[(j + 1) * nx - 1] + offDiagonalProduct(linSys, v, (j + 1) * nx - 1, nx - 1, j);
+        } else {
+            for (int i = 0; i < nx; i++) {
+                int k = j * nx + i;
+
+                y[k] = mainDiagonal(linSys, k) * v[k] + offDiagonalProduct(linSys, v, k, i, j);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Function to compute the residual vector r = b - A x.
+ *
+ * @param linSys Linear system struct.
+ * @param r Residual (nx * ny).
+ */
+static void residualVector(const linearSystem *linSys, real_t *r) {
+    int n = linSys->nx * linSys->ny;
+
+    matrixVectorProduct(linSys, linSys->x, r);
+
+#pragma omp parallel for schedule(static)
+    for (int k = 0; k < n; k++) {
+        r[k] = linSys->b[k] - r[k];
+    }
+}
+
+/**
+ * @brief Function to locate each fine grid point of one dimension on the coarse grid.
+ *
+ * The fine point i lies between the coarse points idx[i] and idx[i] + 1, at the fraction weight[i] of the way. Indexes
+ * -1 and nCoarse are the boundary. When nFine = 2 * nCoarse + 1 the odd points coincide with coarse points. The indexes
+ * never decrease, so the fine points that interpolate from a coarse point are contiguous; their range and the sum of
+ * their weights are kept for the restriction.
+ *
+ * @param nFine Number of fine points.
+ * @param nCoarse Number of coarse points.
+ * @return gridTransfer
+ */
+static gridTransfer initGridTransfer(int nFine, int nCoarse) {
+    gridTransfer t;
+    real_t ratio = (real_t)(nCoarse + 1) / (nFine + 1);
+
+    t.idx = (int *)malloc(nFine * sizeof(int));
+    t.weight = (real_t *)malloc(nFine * sizeof(real_t));
+    t.first = (int *)malloc(nCoarse * sizeof(int));
+    t.end = (int *)calloc(nCoarse, sizeof(int));
+    t.weightSum = (real_t *)calloc(nCoarse, sizeof(real_t));
+
+    for (int c = 0; c < nCoarse; c++) {
+        t.first[c] = nFine;
+    }
+
+    for (int i = 0; i < nFine; i++) {
+        real_t xi = (i + 1) * ratio - 1;
+
+        t.idx[i] = (int)floor(xi);
+        t.weight[i] = xi - t.idx[i];
+
+        for (int d = 0; d < 2; d++) {
+            int c = t.idx[i] + d;
+
+            if (c >= 0 && c < nCoarse) {
+                t.first[c] = i < t.first[c] ? i : t.first[c];
+                t.end[c] = i + 1;
+                t.weightSum[c] += d ? t.weight[i] : 1 - t.weight[i];
+            }
+        }
+    }
+
+    return t;
+}
+
+/**
+ * @brief Function to free the tables of a grid transfer.
+ *
+ * @param t Grid transfer.
+ */
+static void freeGridTransfer(gridTransfer *t) {
+    free(t->idx);
+    free(t->weight);
+    free(t->first);
+    free(t->end);
+    free(t->weightSum);
+}
+
+/**
+ * @brief Function to return the weight of fine point i in the interpolation from coarse point c.
+ *
+ * @param t Grid transfer.
+ * @param i Fine point.
+ * @param c Coarse point, idx[i] or idx[i] + 1.
+ * @return real_t
+ */
+static inline real_t transferWeight(const gridTransfer *t, int i, int c) {
+    return t->idx[i] == c ? 1 - t->weight[i] : t->weight[i];
+}
+
+/**
+ * @brief Function to return a coarse grid value, zero on the boundary.
+ *
+ * @param v Coarse grid array.
+ * @param nx Number of coarse points in x.
+ * @param ny Number of coarse points in y.
+ * @param i Column (may be -1 or nx).
+ * @param j Row (may be -1 or ny).
+ * @return real_t
+ */
+static inline real_t coarseValue(const real_t *v, int nx, int ny, int i, int j) {
+    return (i < 0 || j < 0 || i >= nx || j >= ny) ? 0.0 : v[j * nx + i];
+}
+
+/**
+ * @brief Function to restrict the fine residual to the right-hand side of the coarse system.
+ *
+ * The restriction is the transpose of the bilinear prolongation normalized by the sum of the weights (full weighting on
+ * aligned grids). Each coarse point gathers the fine points that interpolate from it, so the coarse rows are split
+ * across OpenMP threads. The systems are scaled by hx^2 * hy^2, so the result is rescaled to the coarse spacing.
+ *
+ * @param fine Fine system.
+ * @param r Fine residual.
+ * @param coarse Coarse system, its "b" receives the restricted residual.
+ * @param tx Transfer in x.
+ * @param ty Transfer in y.
+ */
+static void restrictResidual(const linearSystem *fine, const real_t *r, linearSystem *coarse, const gridTransfer *tx, const gridTransfer *ty) {
+    int nx = fine->nx, ny = fine->ny, cnx = coarse->nx, cny = coarse->ny;
+    real_t scale = ((real_t)(nx + 1) * (ny + 1)) / ((real_t)(cnx + 1) * (cny + 1));
+
+    scale *= scale;
+
+#pragma omp parallel for schedule(static)
+    for (int cj = 0; cj < cny; cj++) {
+        for (int ci = 0; ci < cnx; ci++) {
+            real_t sum = 0.0;
+
+            for (int j = ty->first[cj]; j < ty->end[cj]; j++) {
+                real_t row = 0.0;
+
+                for (int i = tx->first[ci]; i < tx->end[ci]; i++) {
+                    row += transferWeight(tx, i, ci) * r[j * nx + i];
+                }
+                sum += transferWeight(ty, j, cj) * row;
+            }
+
+            coarse->b[cj * cnx + ci] = sum * scale / (tx->weightSum[ci] * ty->weightSum[cj]);
+        }
+    }
+}
+
+/**
+ * @brief Function to add the bilinear interpolation of the coarse solution (the correction) to the fine solution.
+ *
+ * @param coarse Coarse system.
+ * @param fine Fine system.
+ * @param tx Transfer in x.
+ * @param ty Transfer in y.
+ */
+static void prolongateCorrection(const linearSystem *coarse, linearSystem *fine, const gridTransfer *tx, const gridTransfer *ty) {
+    int nx = fine->nx, ny = fine->ny, cnx = coarse->nx, cny = coarse->ny;
+    const int *idxX = tx->idx, *idxY = ty->idx;
+    const real_t *wX = tx->weight, *wY = ty->weight, *e = coarse->x;
+
+#pragma omp parallel for schedule(static)
+    for (int j = 0; j < ny; j++) {
+        int cj = idxY[j];
+
+        for (int i = 0; i < nx; i++) {
+            int ci = idxX[i];
+            real_t bottom = (1 - wX[i]) * coarseValue(e, cnx, cny, ci, cj) + wX[i] * coarseValue(e, cnx, cny, ci + 1, cj);
+            real_t top = (1 - wX[i]) * coarseValue(e, cnx, cny, ci, cj + 1) + wX[i] * coarseValue(e, cnx, cny, ci + 1, cj + 1);
+
+            fine->x[j * nx + i] += (1 - wY[j]) * bottom + wY[j] * top;
+        }
+    }
+}
+
+/**
+ * @brief Function to do one multigrid cycle on level l, with Gauss Seidel sweeps as smoother.
+ *
+ * The V-cycle visits the coarser level once. The F-cycle first does an F-cycle and then a V-cycle on the coarser level.
+ *
+ * @param mg Multigrid hierarchy.
+ * @param l Level.
+ * @param cycle Cycle type.
+ */
+static void multigridLevelCycle(multigrid *mg, int l, multigridCycle cycle) {
+    linearSystem *level = &mg->levels[l], *coarse = &mg->levels[l + 1];
+
+    if (l == mg->nLevels - 1) {
+        for (int t = 0; t < MG_COARSEST_SWEEPS; t++) {
+            gaussSeidelSweep(level, 1.0);
+        }
+        return;
+    }
+
+    for (int t = 0; t < MG_SMOOTHING_SWEEPS; t++) {
+        gaussSeidelSweep(level, 1.0);
+    }
+
+    residualVector(level, mg->residual[l]);
+    restrictResidual(level, mg->residual[l], coarse, &mg->transferX[l], &mg->transferY[l]);
+    memset(coarse->x, 0, coarse->nx * coarse->ny * sizeof(real_t));
+
+    multigridLevelCycle(mg, l + 1, cycle);
+    if (cycle == F_CYCLE) {
+        multigridLevelCycle(mg, l + 1, V_CYCLE);
+    }
+
+    prolongateCorrection(coarse, level, &mg->transferX[l], &mg->transferY[l]);
+
+    for (int t = 0; t < MG_SMOOTHING_SWEEPS; t++) {
+        gaussSeidelSweep(level, 1.0);
+    }
+}
+
+/**
+ * @brief Function to do nSweeps multigrid cycles.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param data Multigrid hierarchy.
+ * @param nSweeps Number of cycles.
+ * @return real_t L2 norm of the residual after the last cycle.
+ */
+static real_t multigridSweeps(linearSystem *linSys, const solverOptions *opts, void *data, int nSweeps) {
+    for (int t = 0; t < nSweeps; t++) {
+        multigridLevelCycle((multigrid *)data, 0, opts->cycle);
+    }
+
+    return l2Norm(linSys);
+}
+
+// BiCGSTAB state, kept between the calls of bicgstabSweeps().
+typedef struct bicgstab {
+    real_t *r, *rHat, *p, *v, *s, *t, *pHat, *sHat;  // Work vectors (nx * ny).
+    real_t rho, alpha, omega;
+    int restart;  // Set when the recurrence has to be restarted from the true residual.
+} bicgstab;
+
+/**
+ * @brief Function to compute the dot product of two vectors, split across OpenMP threads.
+ *
+ * @param a First vector.
+ * @param b Second vector.
+ * @param n Size.
+ * @return real_t
+ */
+static real_t dotProduct(const real_t *a, const real_t *b, int n) {
+    real_t result = 0.0;
+
+#pragma omp parallel for reduction(+ : result) schedule(static)
+    for (int k = 0; k < n; k++) {
+        result += a[k] * b[k];
+    }
+
+    return result;
+}
+
+/**
+ * @brief Function to apply the Gauss Seidel preconditioner z = (D + L)^-1 v, one forward sweep on A z = v from z = 0.
+ *
+ * Without preconditioning (precondition = 0) z is a copy of v.
+ *
+ * @param linSys Linear system struct.
+ * @param v Vector.
+ * @param z Result.
+ * @param precondition Apply the preconditioner.
+ */
+static void applyPreconditioner(const linearSystem *linSys, const real_t *v, real_t *z, int precondition) {
+    int nx = linSys->nx, ny = linSys->ny;
+
+    if (!precondition) {
+        memcpy(z, v, nx * ny * sizeof(real_t));
+        return;
+    }
+
+    for (int j = 0; j < ny; j++) {
+        for (int i = 0; i < nx; i++) {
+            int k = j * nx + i;
+            real_t sum = v[k];
+
+            if (i > 0) {
+                sum -= (linSys->matrixFree ? linSys->coef.id : linSys->id[k]) * z[k - 1];
+            }
+            if (j > 0) {
+                sum -= (linSys->matrixFree ? linSys->coef.iid : linSys->iid[k]) * z[k - nx];
+            }
+
+            z[k] = sum / mainDiagonal(linSys, k);
+        }
+    }
+}
+
+/**
+ * @brief Function to restart the BiCGSTAB recurrence from the true residual of linSys->x.
+ *
+ * @param linSys Linear system struct.
+ * @param bs BiCGSTAB state.
+ */
+static void restartBicgstab(const linearSystem *linSys, bicgstab *bs) {
+    int n = linSys->nx * linSys->ny;
+
+    residualVector(linSys, bs->r);
+    memcpy(bs->rHat, bs->r, n * sizeof(real_t));
+    memset(bs->p, 0, n * sizeof(real_t));
+    memset(bs->v, 0, n * sizeof(real_t));
+    bs->rho = bs->alpha = bs->omega = 1.0;
+    bs->restart = 0;
+}
+
+/**
+ * @brief Function to do nSweeps iterations of the right preconditioned BiCGSTAB method.
+ *
+ * The recurrence is restarted from the true residual when one of its denominators vanishes. A vanishing rho restarts it
+ * within the same iteration, which then goes on from the new residual; after a restart rho is (r, r), so it only
+ * vanishes again when x solves the system exactly and the remaining iterations are skipped. A vanishing (r^, v) ends the
+ * iteration before alpha is formed and restarts the next one, or stops when the recurrence was just restarted, since a
+ * new restart would reach the same state. A vanishing (t, t) keeps the half step x + alpha * p^ and restarts from its
+ * residual, and an omega of zero restarts the next iteration. The returned norm is the true residual, as for the other
+ * methods.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param data BiCGSTAB state.
+ * @param nSweeps Number of iterations.
+ * @return real_t L2 norm of the residual after the last iteration.
+ */
+static real_t bicgstabSweeps(linearSystem *linSys, const solverOptions *opts, void *data, int nSweeps) {
+    bicgstab *bs = (bicgstab *)data;
+    int n = linSys->nx * linSys->ny;
+    real_t *x = linSys->x, rho, beta, sigma, tt;
+
+    for (int it = 0; it < nSweeps; it++) {
+        int restarted = bs->restart;
+
+        if (bs->restart) {
+            restartBicgstab(linSys, bs);
+        }
+
+        rho = dotProduct(bs->rHat, bs->r, n);
+        if (rho == 0.0) {
+            restartBicgstab(linSys, bs);
+            restarted = 1;
+            rho = dotProduct(bs->rHat, bs->r, n);
+            if (rho == 0.0) {
+                break;
+            }
+        }
+
+        beta = (rho / bs->rho) * (bs->alpha / bs->omega);
+        bs->rho = rho;
+
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; k++) {
+            bs->p[k] = bs->r[k] + beta * (bs->p[k] - bs->omega * bs->v[k]);
+        }
+
+        applyPreconditioner(linSys, bs->p, bs->pHat, opts->precondition);
+        matrixVectorProduct(linSys, bs->pHat, bs->v);
+        sigma = dotProduct(bs->rHat, bs->v, n);
+        if (sigma == 0.0) {
+            if (restarted) {
+                break;
+            }
+            bs->restart = 1;
+            continue;
+        }
+        bs->alpha = rho / sigma;
+
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; k++) {
+            bs->s[k] = bs->r[k] - bs->alpha * bs->v[k];
+        }
+
+        applyPreconditioner(linSys, bs->s, bs->sHat, opts->precondition);
+        matrixVectorProduct(linSys, bs->sHat, bs->t);
+        tt = dotProduct(bs->t, bs->t, n);
+        if (tt == 0.0) {
+#pragma omp parallel for schedule(static)
+            for (int k = 0; k < n; k++) {
+                x[k] += bs->alpha * bs->pHat[k];
+            }
+            restartBicgstab(linSys, bs);
+            continue;
+        }
+        bs->omega = dotProduct(bs->t, bs->s, n) / tt;
+
+#pragma omp parallel for schedule(static)
+        for (int k = 0; k < n; k++) {
+            x[k] += bs->alpha * bs->pHat[k] + bs->omega * bs->sHat[k];
+            bs->r[k] = bs->s[k] - bs->omega * bs->t[k];
+        }
+
+        if (bs->omega == 0.0) {
+            bs->restart = 1;
+        }
+    }
+
+    return l2Norm(linSys);
+}
+
+// Single precision copy of the five point stencil, md holds the inverse of the main diagonal.
+typedef struct floatStencil {
+    float ssd, sd, md, id, iid;
+} floatStencil;
+
+// Mixed precision state, kept between the calls of mixedPrecisionSweeps().
+typedef struct mixedPrecision {
+    float *ssd, *sd, *md, *id, *iid;  // Single precision diagonals, md inverted (NULL when matrix-free).
+    floatStencil coef;                // Single precision stencil coefficients.
+    float *r;                         // Residual of the double precision system, right-hand side of the correction.
+    float *e;                         // Correction with a zero row below and above the grid (nx * (ny + 2)).
+    real_t *residual;                 // Double precision residual (nx * ny).
+} mixedPrecision;
+
+/**
+ * @brief Function to apply the successive over-relaxation to a single precision Gauss Seidel update.
+ *
+ * @param old Current value of the point.
+ * @param gs Value given by the Gauss Seidel update.
+ * @param omega Relaxation factor.
+ * @return float New value of the point.
+ */
+static inline float sorUpdateFloat(float old, float gs, float omega) {
+    return omega == 1.0f ? gs : old + omega * (gs - old);
+}
+
+/**
+ * @brief Function to update grid row j of a single precision Gauss Seidel sweep on the correction equation A e = r.
+ *
+ * The sweep is a chain of dependent updates, so the division is replaced by the product with the inverse of the main
+ * diagonal. The zero rows around e replace the top and bottom edge cases. The diagonal arrays already hold zeros at the left and
+ * right edges, so only the matrix-free rows split the first and last points.
+ *
+ * @param linSys Linear system struct.
+ * @param mp Mixed precision state.
+ * @param j Grid row.
+ * @param omega Relaxation factor.
+ */
+static inline void gaussSeidelRowFloat(const linearSystem *linSys, mixedPrecision *mp, int j, float omega) {
+    int nx = linSys->nx, k = j * nx, end = k + nx - 1;
+    float *x = mp->e + nx;
+    const float *r = mp->r;
+
+    if (mp->md == NULL) {
+        floatStencil c = mp->coef;
+
+        x[k] = sorUpdateFloat(x[k], (r[k] - (c.sd * x[k + 1]) - (c.ssd * x[k + nx]) - (c.iid * x[k - nx])) * c.md, omega);
+        for (k++; k < end; k++) {
+            x[k] = sorUpdateFloat(x[k], (r[k] - (c.sd * x[k + 1]) - (c.ssd * x[k + nx]) - (c.id * x[k - 1]) - (c.iid * x[k - nx])) * c.md, omega);
+        }
+        x[k] = sorUpdateFloat(x[k], (r[k] - (c.ssd * x[k + nx]) - (c.id * x[k - 1]) - (c.iid * x[k - nx])) * c.md, omega);
+    } else {
+        const float *ssd = mp->ssd, *sd = mp->sd, *md = mp->md, *id = mp->id, *iid = mp->iid;
+
+        for (; k <= end; k++) {
+            x[k] = sorUpdateFloat(x[k], (r[k] - (sd[k] * x[k + 1]) - (ssd[k] * x[k + nx]) - (id[k] * x[k - 1]) - (iid[k] * x[k - nx])) * md[k], omega);
+        }
+    }
+}
+
+/**
+ * @brief Function to do one iterative refinement step with nSweeps single precision sweeps.
+ *
+ * The residual r = b - A x is computed in double and rounded to float, the correction equation A e = r is relaxed from
+ * e = 0 with nSweeps lexicographic Gauss Seidel (or SOR) sweeps in float, and x += e is applied in double. Each step
+ * gains about the seven digits of float, so the double residual keeps decreasing past the single precision limit.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param data Mixed precision state.
+ * @param nSweeps Number of single precision sweeps.
+ * @return real_t L2 norm of the residual after the correction.
+ */
+static real_t mixedPrecisionSweeps(linearSystem *linSys, const solverOptions *opts, void *data, int nSweeps) {
+    mixedPrecision *mp = (mixedPrecision *)data;
+    int nx = linSys->nx, n = linSys->nx * linSys->ny;
+    float omega = (float)opts->omega;
+
+    residualVector(linSys, mp->residual);
+
+#pragma omp parallel for schedule(static)
+    for (int k = 0; k < n; k++) {
+        mp->r[k] = (float)mp->residual[k];
+        mp->e[nx + k] = 0.0f;
+    }
+
+    for (int t = 0; t < nSweeps; t++) {
+        for (int j = 0; j < linSys->ny; j++) {
+            gaussSeidelRowFloat(linSys, mp, j, omega);
+        }
+    }
+
+#pragma omp parallel for schedule(static)
+    for (int k = 0; k < n; k++) {
+        linSys->x[k] += mp->e[nx + k];
+    }
+
+    return l2Norm(linSys);
+}
+
+/**
+ * @brief Function to update the relaxation factor from the observed residual contraction (adaptive SOR).
+ *
+ * For the five point stencil the Jacobi spectral radius mu and the SOR contraction rate lambda obtained with omega
+ * satisfy (lambda + omega - 1)^2 = lambda * omega^2 * mu^2. Each estimate of mu^2 is a lower bound while the slowest
+ * mode has not taken over yet, so the largest one is kept and omega = 2 / (1 + sqrt(1 - mu^2)) only grows.
+ *
+ * @param omega Relaxation factor used in the last sweeps.
+ * @param lambda Contraction rate per sweep of the residual.
+ * @param sqrMu Largest estimate of mu^2 so far, updated.
+ * @return real_t New relaxation factor.
+ */
+static real_t estimateOmega(real_t omega, real_t lambda, real_t *sqrMu) {
+    real_t estimate = (lambda + omega - 1) * (lambda + omega - 1) / (lambda * omega * omega);
+
+    if (estimate > *sqrMu && estimate < 1.0) {
+        *sqrMu = estimate;
+    }
+
+    return 2.0 / (1.0 + sqrt(1.0 - *sqrMu));
+}
+
+/**
+ * @brief Function to save the state of iterativeSolve() in a checkpoint.
+ *
+ * @param ckpt Checkpoint struct.
+ * @param linSys Linear system struct.
+ * @param k Sweeps done.
+ * @param nNorms Residual evaluations done.
+ * @param omega Relaxation factor in use.
+ * @param sqrMu Estimate of the adaptive SOR.
+ * @param arrayL2Norm Residual norms.
+ * @param arrayIt Iterations of the residual norms.
+ */
+static void saveSolverState(checkpoint *ckpt, const linearSystem *linSys, int k, int nNorms, real_t omega, real_t sqrMu, const real_t *arrayL2Norm, const int *arrayIt) {
+    checkpointState state = {k, nNorms, omega, sqrMu};
+
+    saveCheckpoint(ckpt, linSys->x, &state, arrayL2Norm, arrayIt);
+}
+
+// Residual of a snapshot of "x", evaluated by a helper thread while the main thread does the next sweeps.
+typedef struct residualMonitor {
+    linearSystem view;  // The system being solved with "x" replaced by the snapshot.
+    real_t *copy;       // Snapshot of "x" (NULL when the monitor is off).
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int pending;         // A snapshot was posted and its norm was not collected yet.
+    int ready;           // The norm of the posted snapshot is available.
+    int quit;            // The helper thread must exit.
+    int it;              // Iteration of the snapshot.
+    real_t norm, time;   // L2 norm of the residual of the snapshot and the time to evaluate it (ms).
+} residualMonitor;
+
+/**
+ * @brief Function run by the helper thread: evaluates the norm of each posted snapshot, adding the row residuals in the
+ * same order as l2Norm().
+ *
+ * @param arg Monitor struct.
+ * @return void*
+ */
+static void *residualHelper(void *arg) {
+    residualMonitor *m = (residualMonitor *)arg;
+
+    pthread_mutex_lock(&m->lock);
+    while (1) {
+        while (!m->quit && (!m->pending || m->ready)) {
+            pthread_cond_wait(&m->cond, &m->lock);
+        }
+        if (m->quit) {
+            break;
+        }
+        pthread_mutex_unlock(&m->lock);
+
+        real_t result = 0.0, start = timestamp();
+
+        for (int j = 0; j < m->view.ny; j++) {
+            result += residualRow(&m->view, j);
+        }
+
+        pthread_mutex_lock(&m->lock);
+        m->norm = sqrt(result);
+        m->time = timestamp() - start;
+        m->ready = 1;
+        pthread_cond_broadcast(&m->cond);
+    }
+    pthread_mutex_unlock(&m->lock);
+
+    return NULL;
+}
+
+/**
+ * @brief Function to start the helper thread of the asynchronous residual. If it can not be started the monitor stays
+ * off (copy is NULL) and the residual is evaluated by the sweeps.
+ *
+ * @param m Monitor struct.
+ * @param linSys Linear system struct.
+ */
+static void startResidualMonitor(residualMonitor *m, const linearSystem *linSys) {
+    memset(m, 0, sizeof(residualMonitor));
+    m->view = *linSys;
+    m->copy = (real_t *)malloc((size_t)linSys->nx * linSys->ny * sizeof(real_t));
+    m->view.x = m->copy;
+    pthread_mutex_init(&m->lock, NULL);
+    pthread_cond_init(&m->cond, NULL);
+
+    if (m->copy && pthread_create(&m->thread, NULL, residualHelper, m) != 0) {
+        free(m->copy);
+        m->copy = NULL;
+    }
+}
+
+/**
+ * @brief Function to copy "x" to the snapshot and hand it to the helper thread. The previous norm must be collected.
+ *
+ * @param m Monitor struct.
+ * @param linSys Linear system struct.
+ * @param it Iteration of the snapshot.
+ */
+static void postResidual(residualMonitor *m, const linearSystem *linSys, int it) {
+    memcpy(m->copy, linSys->x, (size_t)linSys->nx * linSys->ny * sizeof(real_t));
+
+    pthread_mutex_lock(&m->lock);
+    m->it = it;
+    m->pending = 1;
+    m->ready = 0;
+    pthread_cond_broadcast(&m->cond);
+    pthread_mutex_unlock(&m->lock);
+}
+
+/**
+ * @brief Function to wait for the norm of the posted snapshot. Its evaluation time is added to the residual region.
+ *
+ * @param m Monitor struct.
+ * @param timer Residual region.
+ * @return real_t L2 norm of the residual of the snapshot.
+ */
+static real_t collectResidual(residualMonitor *m, timerRegion *timer) {
+    pthread_mutex_lock(&m->lock);
+    while (!m->ready) {
+        pthread_cond_wait(&m->cond, &m->lock);
+    }
+    m->pending = 0;
+    pthread_mutex_unlock(&m->lock);
+
+    addTimerSample(timer, m->time);
+
+    return m->norm;
+}
+
+/**
+ * @brief Function to stop the helper thread and free the snapshot.
+ *
+ * @param m Monitor struct.
+ */
+static void stopResidualMonitor(residualMonitor *m) {
+    if (m->copy) {
+        pthread_mutex_lock(&m->lock);
+        m->quit = 1;
+        pthread_cond_broadcast(&m->cond);
+        pthread_mutex_unlock(&m->lock);
+        pthread_join(m->thread, NULL);
+        free(m->copy);
+    }
+
+    pthread_mutex_destroy(&m->lock);
+    pthread_cond_destroy(&m->cond);
+}
+
+/**
+ * @brief Function to re-estimate the SOR relaxation factor after a residual evaluation, when it is automatic.
+ *
+ * The chunk right after a change of omega is a transient, so the contraction of the last two norms is only used when
+ * that chunk is not between them: the older norm must come from a sweep done with the current omega. With synchronous
+ * residuals this skips every other check; with asynchronous ones the norms arrive one chunk late and the rule still
+ * holds, since it follows the iterations of the norms and not their count.
+ *
+ * @param opts Solver options.
+ * @param run Options of the run, whose omega is updated.
+ * @param arrayL2Norm Norms of the checks so far.
+ * @param arrayIt Iterations of those norms.
+ * @param nNorms Number of checks.
+ * @param k Sweeps done, the next sweep uses the new omega.
+ * @param omegaFrom First sweep done with the current omega, updated.
+ * @param sqrMu Current estimate of the squared spectral radius of Jacobi.
+ */
+static void updateOmega(const solverOptions *opts, solverOptions *run, const real_t *arrayL2Norm, const int *arrayIt, int nNorms, int k, int *omegaFrom, real_t *sqrMu) {
+    if (opts->omega == SOR_AUTO_OMEGA && nNorms >= 2 && nNorms <= SOR_ESTIMATE_CHECKS && arrayIt[nNorms - 2] >= *omegaFrom && arrayL2Norm[nNorms - 1] < arrayL2Norm[nNorms - 2]) {
+        run->omega = estimateOmega(run->omega, pow(arrayL2Norm[nNorms - 1] / arrayL2Norm[nNorms - 2], 1.0 / (arrayIt[nNorms - 1] - arrayIt[nNorms - 2])), sqrMu);
+        *omegaFrom = k;
+    }
+}
+
+/**
+ * @brief Function to set a timed region that receives one sample per chunk of the following solves: the time of the
+ * call to the sweep function divided by its sweeps. The residual the method evaluates in that call is included, the
+ * setup of the method (allocations, conversions, the multigrid levels) and the report are not.
+ *
+ * @param timer Timed region, or NULL to stop.
+ */
+void setChunkTimer(timerRegion *timer) {
+    chunkTimer = timer;
+}
+
+/**
+ * @brief Function with the iteration loop shared by the methods.
+ *
+ * The sweeps are done in chunks of opts->resEvery sweeps (the last chunk may be shorter), and the residual is only
+ * evaluated at the end of each chunk. The loop stops after opts->maxIt sweeps or as soon as an evaluated residual falls
+ * below opts->tol. When opts->omega is SOR_AUTO_OMEGA the first chunks run with omega 1 and then the relaxation factor
+ * is re-estimated after each of the first SOR_ESTIMATE_CHECKS residual evaluations. Nothing is printed when output is
+ * NULL (the MPI ranks other than 0).
+ *
+ * With opts->restartFile the solution, the sweep count, the residual history and the relaxation factor are taken from
+ * that checkpoint (a missing or mismatched file starts from zero, with a warning), and opts->maxIt counts the sweeps of
+ * both runs. With opts->checkpointFile a snapshot is saved at the end of each chunk that crosses a multiple of
+ * opts->checkpointEvery sweeps, and once more at the end. Other method data (multigrid levels, Krylov vectors) is
+ * rebuilt, which for BiCGSTAB means a restart of the recurrence.
+ *
+ * Each chunk adds one sample to the "Varredura" region, its time per sweep without the separate residual evaluations
+ * (l2Norm() and the batched norm), which are the samples of the "Resíduo" region. The fused Gauss Seidel kernel has no
+ * separate residual, so its sweep samples include it. A chunk is swept by one call (the wavefront method blocks its
+ * sweeps), so with opts->resEvery > 1 a sample is the mean of the sweeps of a chunk and the table says so. The table
+ * follows printGaussSeidelParameters().
+ *
+ * With opts->asyncResidual the sweeps do not evaluate the residual. At the end of each chunk "x" is copied to a snapshot
+ * whose norm a helper thread evaluates while the next chunk is swept, so the norm of a chunk is collected one chunk
+ * later, with its own iteration number. With a fixed omega the norms are the synchronous ones; with SOR_AUTO_OMEGA the
+ * estimate sees each norm one chunk late, so omega changes later and the iterates differ from the synchronous run. The
+ * norm of the current chunk is waited for after the last chunk, before a checkpoint and once a collected norm is below
+ * opts->tol, so convergence may be noticed one chunk late. The "Varredura" samples are then the sweeps alone and the
+ * "Resíduo" samples the hidden evaluations.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param output Output file, or NULL.
+ * @param sweeps Function that does n sweeps and returns the L2 norm of the residual after the last one.
+ * @param data Method data passed to sweeps.
+ */
+void iterativeSolve(linearSystem *linSys, const solverOptions *opts, FILE *output, sweepFunction sweeps, void *data) {
+    real_t itTime, *arrayL2Norm, acumItTime, norm = 0.0, sqrMu = 0.0;
+    int *arrayIt, nSweeps, nNorms = 0, k = 0, k0, maxNorms, saved, omegaFrom;
+    int saveEvery = opts->checkpointFile ? opts->checkpointEvery : 0;
+    real_t *savedL2Norm = NULL;
+    int *savedIt = NULL;
+    solverOptions run = *opts;
+    checkpointState state;
+    checkpoint ckpt;
+    residualMonitor monitor;
+    timerRegion timers[2] = {initTimerRegion("Varredura"), initTimerRegion("Resíduo")};
+    acumItTime = 0.0;
+
+    if (opts->omega == SOR_AUTO_OMEGA) {
+        run.omega = 1.0;
+    }
+
+    if (opts->restartFile) {
+        if (loadCheckpoint(opts->restartFile, linSys->nx, linSys->ny, linSys->nz, opts->maxIt, linSys->x, &state, &savedL2Norm, &savedIt) == 0) {
+            k = state.it;
+            nNorms = state.nNorms;
+            run.omega = state.omega;
+            sqrMu = state.sqrMu;
+            norm = nNorms > 0 ? savedL2Norm[nNorms - 1] : 0.0;
+        } else {
+            fprintf(stderr, "Não foi possível retomar de \"%s\", iniciando do zero.\n", opts->restartFile);
+        }
+    }
+
+    k0 = saved = omegaFrom = k;
+    maxNorms = nNorms + (run.maxIt > k ? (run.maxIt - k) / run.resEvery : 0) + 1;
+    arrayL2Norm = (real_t *)malloc(maxNorms * sizeof(real_t));
+    arrayIt = (int *)malloc(maxNorms * sizeof(int));
+
+    if (nNorms > 0) {
+        memcpy(arrayL2Norm, savedL2Norm, nNorms * sizeof(real_t));
+        memcpy(arrayIt, savedIt, nNorms * sizeof(int));
+    }
+    free(savedL2Norm);
+    free(savedIt);
+
+    // The new checkpoint keeps a temporary name until its first snapshot is complete, so it may replace the restart file.
+    if (saveEvery > 0 && createCheckpoint(&ckpt, opts->checkpointFile, linSys->nx, linSys->ny, linSys->nz, maxNorms) != 0) {
+        fprintf(stderr, "Erro ao criar o checkpoint \"%s\".\n", opts->checkpointFile);
+        saveEvery = 0;
+    }
+
+    if (opts->asyncResidual) {
+        startResidualMonitor(&monitor, linSys);
+    } else {
+        monitor.copy = NULL;
+    }
+    run.asyncResidual = monitor.copy != NULL;
+
+    residualTimer = &timers[1];
+
+    LIKWID_MARKER_START("Gauss_Seidel_Likwid_Performance");
+    while (k < run.maxIt) {
+        int nResiduals = timers[1].nSamples, deferred = 0;
+        real_t residualTime = 0.0, sweepTime;
+
+        nSweeps = run.maxIt - k < run.resEvery ? run.maxIt - k : run.resEvery;
+        itTime = timestamp();
+
+        norm = sweeps(linSys, &run, data, nSweeps);
+
+        sweepTime = timestamp() - itTime;
+        k += nSweeps;
+
+        if (chunkTimer) {
+            addTimerSample(chunkTimer, sweepTime / nSweeps);
+        }
+
+        if (run.asyncResidual) {
+            if (monitor.pending) {
+                arrayL2Norm[nNorms] = collectResidual(&monitor, &timers[1]);
+                arrayIt[nNorms++] = monitor.it;
+                updateOmega(opts, &run, arrayL2Norm, arrayIt, nNorms, k, &omegaFrom, &sqrMu);
+            }
+            postResidual(&monitor, linSys, k - 1);
+
+            deferred = k < run.maxIt && !(nNorms > 0 && arrayL2Norm[nNorms - 1] < run.tol) && !(saveEvery > 0 && k / saveEvery > saved / saveEvery);
+            if (!deferred) {
+                norm = collectResidual(&monitor, &timers[1]);
+            }
+        }
+
+        itTime = timestamp() - itTime;
+        acumItTime += itTime;
+        for (int r = nResiduals; r < timers[1].nSamples; r++) {
+            residualTime += timers[1].samples[r];
+        }
+        addTimerSample(&timers[0], (run.asyncResidual ? sweepTime : itTime - residualTime) / nSweeps);
+
+        if (deferred) {
+            continue;
+        }
+
+        arrayL2Norm[nNorms] = norm;
+        arrayIt[nNorms++] = k - 1;
+
+        if (norm < run.tol) {
+            break;
+        }
+
+        updateOmega(opts, &run, arrayL2Norm, arrayIt, nNorms, k, &omegaFrom, &sqrMu);
+
+        if (saveEvery > 0 && k / saveEvery > saved / saveEvery) {
+            saveSolverState(&ckpt, linSys, k, nNorms, run.omega, sqrMu, arrayL2Norm, arrayIt);
+            saved = k;
+        }
+    }
+    LIKWID_MARKER_STOP("Gauss_Seidel_Likwid_Performance");
+
+    residualTimer = NULL;
+
+    if (opts->asyncResidual) {
+        stopResidualMonitor(&monitor);
+    }
+
+    if (saveEvery > 0) {
+        if (saved != k || k == k0) {
+            saveSolverState(&ckpt, linSys, k, nNorms, run.omega, sqrMu, arrayL2Norm, arrayIt);
+        }
+        closeCheckpoint(&ckpt);
+    }
+
+    if (output) {
+        printGaussSeidelParameters(k > k0 ? acumItTime / (k - k0) : 0.0, arrayL2Norm, arrayIt, output, nNorms);
+        printTimerRegions(timers, 2, output);
+        if (run.resEvery > 1) {
+            fprintf(output, "# Cada amostra de Varredura é a média de um bloco de %d iterações.\n", run.resEvery);
+        }
+
+        if (k0 > 0) {
+            fprintf(output, "# Retomado na iteração %d\n", k0);
+        }
+
+        if (run.omega != 1.0) {
+            fprintf(output, "# Omega SOR: %lf\n", run.omega);
+        }
+
+        if (run.tol > 0.0) {
+            if (norm < run.tol) {
+                fprintf(output, "# Convergiu em %d iterações (tolerância %g)\n", k, run.tol);
+            } else {
+                fprintf(output, "# Não convergiu em %d iterações (tolerância %g)\n", k, run.tol);
+            }
+        }
+    }
+
+    free(arrayL2Norm);
+    free(arrayIt);
+    freeTimerRegion(&timers[0]);
+    freeTimerRegion(&timers[1]);
+}
+
+/**
+ * @brief Gauss Seidel function.
+ *
+ * The residual is computed by the fused kernel, so the time per iteration includes the L2 norm.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param output Output file.
+ */
+void gaussSeidel(linearSystem *linSys, const solverOptions *opts, FILE *output) {
+    iterativeSolve(linSys, opts, output, gaussSeidelSweeps, NULL);
+}
+
+/**
+ * @brief Pipelined Gauss Seidel function, the lexicographic sweep is split in column blocks across OpenMP threads.
+ *
+ * The iterates and the residuals are bitwise the ones of gaussSeidel(). Each thread gets at least PIPELINE_MIN_COLUMNS
+ * columns, so narrow grids use fewer threads.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param output Output file.
+ */
+void pipelinedGaussSeidel(linearSystem *linSys, const solverOptions *opts, FILE *output) {
+    pipeline pl;
+
+    pl.nThreads = linSys->nx / PIPELINE_MIN_COLUMNS < omp_get_max_threads() ? linSys->nx / PIPELINE_MIN_COLUMNS : omp_get_max_threads();
+    pl.nThreads = pl.nThreads > 0 ? pl.nThreads : 1;
+    pl.progress = (long *)calloc((size_t)pl.nThreads * PIPELINE_STRIDE, sizeof(long));
+    pl.rowResidual = (real_t *)malloc(linSys->ny * sizeof(real_t));
+
+    iterativeSolve(linSys, opts, output, pipelinedSweeps, &pl);
+
+    if (output) {
+        fprintf(output, "# Threads do pipeline: %d\n", pl.nThreads);
+    }
+
+    free(pl.progress);
+    free(pl.rowResidual);
+}
+
+/**
+ * @brief Temporally blocked Gauss Seidel function, opts->depth sweeps are done per pass over memory.
+ *
+ * The iterates are the same as gaussSeidel(). A pass can not go past a residual evaluation, so opts->resEvery should be
+ * at least opts->depth.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param output Output file.
+ */
+void wavefrontGaussSeidel(linearSystem *linSys, const solverOptions *opts, FILE *output) {
+    iterativeSolve(linSys, opts, output, wavefrontSweeps, NULL);
+}
+
+/**
+ * @brief Geometric multigrid function, one iteration is one V-cycle or F-cycle (opts->cycle).
+ *
+ * Each dimension is halved (n / 2 points) while it has at least 4 points, and every coarse level is matrix-free with
+ * the stencil of setLinearSystem() at its own spacing.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param output Output file.
+ */
+void multigridSolver(linearSystem *linSys, const solverOptions *opts, FILE *output) {
+    multigrid mg;
+    int nx = linSys->nx, ny = linSys->ny;
+
+    mg.nLevels = 1;
+    while (nx >= 4 || ny >= 4) {
+        nx = nx >= 4 ? nx / 2 : nx;
+        ny = ny >= 4 ? ny / 2 : ny;
+        mg.nLevels++;
+    }
+
+    mg.levels = (linearSystem *)malloc(mg.nLevels * sizeof(linearSystem));
+    mg.residual = (real_t **)malloc(mg.nLevels * sizeof(real_t *));
+    mg.transferX = (gridTransfer *)malloc((mg.nLevels - 1) * sizeof(gridTransfer));
+    mg.transferY = (gridTransfer *)malloc((mg.nLevels - 1) * sizeof(gridTransfer));
+    mg.levels[0] = *linSys;
+    nx = linSys->nx;
+    ny = linSys->ny;
+
+    for (int l = 0; l < mg.nLevels; l++) {
+        if (l > 0) {
+            nx = nx >= 4 ? nx / 2 : nx;
+            ny = ny >= 4 ? ny / 2 : ny;
+            mg.levels[l] = initLinearSystem(nx, ny, 1, 0);
+            mg.levels[l].prob = linSys->prob;
+            setStencil(&mg.levels[l]);
+            mg.transferX[l - 1] = initGridTransfer(mg.levels[l - 1].nx, nx);
+            mg.transferY[l - 1] = initGridTransfer(mg.levels[l - 1].ny, ny);
+        }
+        mg.residual[l] = (real_t *)malloc(nx * ny * sizeof(real_t));
+    }
+
+    iterativeSolve(linSys, opts, output, multigridSweeps, &mg);
+    if (output) {
+        fprintf(output, "# Níveis multigrid: %d (%s-cycle)\n", mg.nLevels, opts->cycle == F_CYCLE ? "F" : "V");
+    }
+
+    for (int l = 0; l < mg.nLevels; l++) {
+        if (l > 0) {
+            freeLinearSystem(&mg.levels[l]);
+            freeGridTransfer(&mg.transferX[l - 1]);
+            freeGridTransfer(&mg.transferY[l - 1]);
+        }
+        free(mg.residual[l]);
+    }
+    free(mg.levels);
+    free(mg.residual);
+    free(mg.transferX);
+    free(mg.transferY);
+}
+
+/**
+ * @brief BiCGSTAB function for the non-symmetric pentadiagonal system, optionally preconditioned by one Gauss Seidel
+ * sweep (opts->precondition). One iteration costs two products by A and, if enabled, two preconditioner sweeps.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param output Output file.
+ */
+void bicgstabSolver(linearSystem *linSys, const solverOptions *opts, FILE *output) {
+    bicgstab bs;
+    int n = linSys->nx * linSys->ny;
+    real_t **vectors[] = {&bs.r, &bs.rHat, &bs.p, &bs.v, &bs.s, &bs.t, &bs.pHat, &bs.sHat};
+
+    for (int i = 0; i < 8; i++) {
+        *vectors[i] = (real_t *)malloc(n * sizeof(real_t));
+    }
+    bs.restart = 1;
+
+    iterativeSolve(linSys, opts, output, bicgstabSweeps, &bs);
+
+    for (int i = 0; i < 8; i++) {
+        free(*vectors[i]);
+    }
+}
+
+/**
+ * @brief Mixed precision Gauss Seidel function, the sweeps run in float on the correction equation and every
+ * opts->resEvery sweeps the residual and the solution are refined in double.
+ *
+ * The float sweeps move half of the bytes of the double ones. Each refinement step adds a double precision residual
+ * and correction pass, so opts->resEvery should be well above 1.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param output Output file.
+ */
+void mixedPrecisionGaussSeidel(linearSystem *linSys, const solverOptions *opts, FILE *output) {
+    mixedPrecision mp;
+    int n = linSys->nx * linSys->ny;
+    real_t *diagonals[] = {linSys->ssd, linSys->sd, linSys->md, linSys->id, linSys->iid};
+    float **floatDiagonals[] = {&mp.ssd, &mp.sd, &mp.md, &mp.id, &mp.iid};
+
+    for (int d = 0; d < 5; d++) {
+        *floatDiagonals[d] = NULL;
+
+        if (!linSys->matrixFree) {
+            *floatDiagonals[d] = (float *)malloc(n * sizeof(float));
+            for (int k = 0; k < n; k++) {
+                (*floatDiagonals[d])[k] = (float)(d == 2 ? 1.0 / diagonals[d][k] : diagonals[d][k]);
+            }
+        }
+    }
+
+    mp.coef.ssd = (float)linSys->coef.ssd;
+    mp.coef.sd = (float)linSys->coef.sd;
+    mp.coef.md = (float)(1.0 / linSys->coef.md);
+    mp.coef.id = (float)linSys->coef.id;
+    mp.coef.iid = (float)linSys->coef.iid;
+
+    mp.r = (float *)malloc(n * sizeof(float));
+    mp.e = (float *)calloc(n + 2 * linSys->nx, sizeof(float));
+    mp.residual = (real_t *)malloc(n * sizeof(real_t));
+
+    iterativeSolve(linSys, opts, output, mixedPrecisionSweeps, &mp);
+
+    for (int d = 0; d < 5; d++) {
+        free(*floatDiagonals[d]);
+    }
+    free(mp.r);
+    free(mp.e);
+    free(mp.residual);
+}
+
+/**
+ * @brief Red-black Gauss Seidel function, each color sweep is split across OpenMP threads.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param output Output file.
+ */
+void redBlackGaussSeidel(linearSystem *linSys, const solverOptions *opts, FILE *output) {
+    iterativeSolve(linSys, opts, output, redBlackSweeps, NULL);
+}
+
+/**
+ * @brief Function to return the value of point (i, j) of a solved grid, or the boundary value of the problem when the
+ * point is on the ring of edges around it (i or j equal to -1, nx or ny).
+ *
+ * @param linSys Linear system struct.
+ * @param i Column.
+ * @param j Row.
+ * @param hx Spacing in x.
+ * @param hy Spacing in y.
+ * @return real_t
+ */
+static inline real_t gridValue(const linearSystem *linSys, int i, int j, real_t hx, real_t hy) {
+    const problem *prob = linSys->prob;
+
+    if (j < 0) {
+        return prob->bottom(prob->x0 + (i + 1) * hx);
+    }
+    if (j >= linSys->ny) {
+        return prob->top(prob->x0 + (i + 1) * hx);
+    }
+    if (i < 0) {
+        return prob->left(prob->y0 + (j + 1) * hy);
+    }
+    if (i >= linSys->nx) {
+        return prob->right(prob->y0 + (j + 1) * hy);
+    }
+
+    return linSys->x[j * linSys->nx + i];
+}
+
+/**
+ * @brief Function to set "x" of the fine grid to the bilinear interpolation of the solution of the coarse one. Both
+ * grids discretize the same domain, which need not be nested: each fine point is placed among the four coarse points
+ * around it, the boundary values of the problem standing for the points outside the coarse grid.
+ *
+ * @param coarse Solved coarse system.
+ * @param fine Fine system.
+ */
+static void interpolateBilinear(const linearSystem *coarse, linearSystem *fine) {
+    real_t hxc, hyc, hxf, hyf;
+
+    gridSpacing(coarse, &hxc, &hyc);
+    gridSpacing(fine, &hxf, &hyf);
+
+#pragma omp parallel for schedule(static)
+    for (int j = 0; j < fine->ny; j++) {
+        real_t qy = (j + 1) * hyf / hyc - 1;
+        int jc = (int)floor(qy);
+        real_t ty = qy - jc;
+
+        for (int i = 0; i < fine->nx; i++) {
+            real_t qx = (i + 1) * hxf / hxc - 1;
+            int ic = (int)floor(qx);
+            real_t tx = qx - ic;
+            real_t lower = (1 - tx) * gridValue(coarse, ic, jc, hxc, hyc) + tx * gridValue(coarse, ic + 1, jc, hxc, hyc);
+            real_t upper = (1 - tx) * gridValue(coarse, ic, jc + 1, hxc, hyc) + tx * gridValue(coarse, ic + 1, jc + 1, hxc, hyc);
+
+            fine->x[j * fine->nx + i] = (1 - ty) * lower + ty * upper;
+        }
+    }
+}
+
+/**
+ * @brief Function to set the initial guess of linSys by grid sequencing: the same problem is solved on up to "levels"
+ * coarser grids, (nx + 1) / 2^l - 1 by (ny + 1) / 2^l - 1 points, from the coarsest one, and each solution is
+ * interpolated to the next grid as its initial guess, the last one to linSys.
+ *
+ * The coarse solves use the method and options of the fine one, without checkpoints and reports. The systems are scaled
+ * by hx^2 * hy^2 and the norm adds nx * ny points, so the tolerance of each level is rescaled by the ratio of
+ * hx^2 * hy^2 * sqrt(nx * ny) to the fine grid, which asks for the same residual per point of the unscaled equation.
+ * The tolerance is the only stopping rule of the coarse levels besides opts->maxIt, so it must be positive (pdeSolver
+ * rejects --sequence without -t). Levels with less than 3 points in a direction are skipped.
+ *
+ * @param linSys Linear system struct, already set.
+ * @param opts Solver options.
+ * @param levels Number of coarser grids.
+ * @param solver Method used on the coarse grids.
+ * @return int Number of coarse grids solved.
+ */
+int sequenceInitialGuess(linearSystem *linSys, const solverOptions *opts, int levels, void (*solver)(linearSystem *, const solverOptions *, FILE *)) {
+    linearSystem previous;
+    solverOptions coarseOpts = *opts;
+    real_t hx, hy, hxf, hyf;
+    int solved = 0;
+
+    coarseOpts.checkpointFile = coarseOpts.restartFile = NULL;
+    gridSpacing(linSys, &hxf, &hyf);
+
+    while (levels > 0 && ((linSys->nx + 1) >> levels) - 1 < 3) {
+        levels--;
+    }
+    while (levels > 0 && ((linSys->ny + 1) >> levels) - 1 < 3) {
+        levels--;
+    }
+
+    for (int l = levels; l > 0; l--) {
+        linearSystem coarse = initLinearSystem(((linSys->nx + 1) >> l) - 1, ((linSys->ny + 1) >> l) - 1, linSys->matrixFree, 0);
+
+        if (!coarse.arena) {
+            break;
+        }
+
+        coarse.prob = linSys->prob;
+        setLinearSystem(&coarse);
+        if (solved > 0) {
+            interpolateBilinear(&previous, &coarse);
+            freeLinearSystem(&previous);
+        }
+
+        gridSpacing(&coarse, &hx, &hy);
+        coarseOpts.tol = opts->tol * (hx * hx * hy * hy * sqrt((real_t)coarse.nx * coarse.ny)) / (hxf * hxf * hyf * hyf * sqrt((real_t)linSys->nx * linSys->ny));
+        solver(&coarse, &coarseOpts, NULL);
+
+        previous = coarse;
+        solved++;
+    }
+
+    if (solved > 0) {
+        interpolateBilinear(&previous, linSys);
+        freeLinearSystem(&previous);
+    }
+
+    return solved;
+}
+
+/**
+ * @brief Function to allocate a batch of nRhs systems with the operator of setLinearSystem().
+ *
+ * The operator is a regular linear system (its stencil is set, its "b" and "x" are free for the caller). The batch
+ * arrays are interleaved, value r of grid point k at [k * nRhs + r], and start zeroed.
+ *
+ * @param nx Number of points in x.
+ * @param ny Number of points in y.
+ * @param nRhs Number of right-hand sides.
+ * @param matrixFree If set the operator has no diagonal arrays.
+ * @param hugePages If set the operator arena is backed by 2MB pages when the system allows it.
+ * @return batchSystem Batch struct (b and x are NULL if the allocation failed).
+ */
+batchSystem initBatchSystem(int nx, int ny, int nRhs, int matrixFree, int hugePages) {
+    batchSystem batch;
+    size_t bytes = (size_t)nx * ny * nRhs * sizeof(real_t);
+    void *b = NULL, *x = NULL;
+
+    batch.op = initLinearSystem(nx, ny, matrixFree, hugePages);
+    if (batch.op.arena) {
+        setStencil(&batch.op);
+    }
+
+    batch.nRhs = nRhs;
+    if (posix_memalign(&b, ARENA_ALIGNMENT, bytes) != 0 || posix_memalign(&x, ARENA_ALIGNMENT, bytes) != 0 || !batch.op.arena) {
+        free(b);
+        free(x);
+        b = x = NULL;
+    } else {
+        memset(b, 0, bytes);
+        memset(x, 0, bytes);
+    }
+
+    batch.norms = (real_t *)calloc(nRhs, sizeof(real_t));
+    batch.zero = (real_t *)calloc(nRhs, sizeof(real_t));
+    if (!batch.norms || !batch.zero) {
+        free(b);
+        free(x);
+        b = x = NULL;
+    }
+
+    batch.b = (real_t *)b;
+    batch.x = (real_t *)x;
+
+    return batch;
+}
+
+/**
+ * @brief Function to free a batch of systems.
+ *
+ * @param batch Batch struct.
+ */
+void freeBatchSystem(batchSystem *batch) {
+    freeLinearSystem(&batch->op);
+    free(batch->b);
+    free(batch->x);
+    free(batch->norms);
+    free(batch->zero);
+
+    batch->b = batch->x = batch->norms = batch->zero = NULL;
+}
+
+/**
+ * @brief Function to copy a right-hand side into the batch.
+ *
+ * @param batch Batch struct.
+ * @param r Index of the system.
+ * @param b Right-hand side (nx * ny).
+ */
+void setBatchRightHandSide(batchSystem *batch, int r, const real_t *b) {
+    int n = batch->op.nx * batch->op.ny;
+
+    for (int k = 0; k < n; k++) {
+        batch->b[k * batch->nRhs + r] = b[k];
+    }
+}
+
+/**
+ * @brief Function to copy a solution out of the batch.
+ *
+ * @param batch Batch struct.
+ * @param r Index of the system.
+ * @param x Solution (nx * ny).
+ */
+void getBatchSolution(const batchSystem *batch, int r, real_t *x) {
+    int n = batch->op.nx * batch->op.ny;
+
+    for (int k = 0; k < n; k++) {
+        x[k] = batch->x[k * batch->nRhs + r];
+    }
+}
+
+/**
+ * @brief Function to load the five coefficients of grid point k, with zero for the neighbours outside of the mesh.
+ *
+ * @param linSys Operator.
+ * @param k Grid point.
+ * @param i Column.
+ * @param j Row.
+ * @param c Receives the coefficients.
+ */
+static inline void pointStencil(const linearSystem *linSys, int k, int i, int j, stencil *c) {
+    if (linSys->matrixFree) {
+        *c = linSys->coef;
+    } else {
+        c->ssd = linSys->ssd[k];
+        c->sd = linSys->sd[k];
+        c->md = linSys->md[k];
+        c->id = linSys->id[k];
+        c->iid = linSys->iid[k];
+    }
+
+    c->id = i > 0 ? c->id : 0.0;
+    c->sd = i < linSys->nx - 1 ? c->sd : 0.0;
+    c->iid = j > 0 ? c->iid : 0.0;
+    c->ssd = j < linSys->ny - 1 ? c->ssd : 0.0;
+}
+
+/**
+ * @brief Function to do one lexicographic Gauss Seidel sweep on all the systems of the batch.
+ *
+ * The coefficients of a point are loaded once and the nRhs updates run in SIMD lanes. A missing neighbour gets a zero
+ * coefficient and points at batch->zero, which subtracts an exact zero and keeps every neighbour apart from the updated
+ * point, and the term order of each row is the one of gaussSeidelRow(), so every system follows the iterates of
+ * gaussSeidel() with the generic kernels (the specialized ones of a problem are not used here).
+ *
+ * @param batch Batch struct.
+ * @param omega Relaxation factor.
+ */
+static void batchGaussSeidelSweep(batchSystem *batch, real_t omega) {
+    const linearSystem *op = &batch->op;
+    int nx = op->nx, ny = op->ny, nRhs = batch->nRhs;
+    real_t *x = batch->x;
+    const real_t *b = batch->b, *zero = batch->zero;
+    stencil c;
+
+    for (int j = 0; j < ny; j++) {
+        for (int i = 0; i < nx; i++) {
+            int k = j * nx + i;
+            real_t *restrict xk = x + (size_t)k * nRhs;
+            const real_t *restrict bk = b + (size_t)k * nRhs;
+            const real_t *restrict left = i > 0 ? xk - nRhs : zero, *restrict right = i < nx - 1 ? xk + nRhs : zero;
+            const real_t *restrict down = j > 0 ? xk - (size_t)nx * nRhs : zero, *restrict up = j < ny - 1 ? xk + (size_t)nx * nRhs : zero;
+
+            pointStencil(op, k, i, j, &c);
+
+            if (j < ny - 1) {
+#pragma omp simd
+                for (int r = 0; r < nRhs; r++) {
+                    xk[r] = sorUpdate(xk[r], (bk[r] - (c.sd * right[r]) - (c.ssd * up[r]) - (c.id * left[r]) - (c.iid * down[r])) / c.md, omega);
+                }
+            } else {
+#pragma omp simd
+                for (int r = 0; r < nRhs; r++) {
+                    xk[r] = sorUpdate(xk[r], (bk[r] - (c.iid * down[r]) - (c.id * left[r]) - (c.sd * right[r])) / c.md, omega);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Function to compute the L2 norm of the residual of each system of the batch into batch->norms.
+ *
+ * @param batch Batch struct.
+ * @return real_t Largest of the norms.
+ */
+static real_t batchL2Norm(batchSystem *batch) {
+    const linearSystem *op = &batch->op;
+    int nx = op->nx, ny = op->ny, nRhs = batch->nRhs;
+    const real_t *x = batch->x, *b = batch->b, *zero = batch->zero;
+    real_t *restrict sums = batch->norms, largest = 0.0, start = timestamp();
+    stencil c;
+
+    memset(sums, 0, nRhs * sizeof(real_t));
+
+    for (int j = 0; j < ny; j++) {
+        for (int i = 0; i < nx; i++) {
+            int k = j * nx + i;
+            const real_t *xk = x + (size_t)k * nRhs, *bk = b + (size_t)k * nRhs;
+            const real_t *left = i > 0 ? xk - nRhs : zero, *right = i < nx - 1 ? xk + nRhs : zero;
+            const real_t *down = j > 0 ? xk - (size_t)nx * nRhs : zero, *up = j < ny - 1 ? xk + (size_t)nx * nRhs : zero;
+
+            pointStencil(op, k, i, j, &c);
+
+#pragma omp simd
+            for (int r = 0; r < nRhs; r++) {
+                real_t res = (bk[r] - (c.sd * right[r]) - (c.ssd * up[r]) - (c.id * left[r]) - (c.iid * down[r])) - c.md * xk[r];
+
+                sums[r] += res * res;
+            }
+        }
+    }
+
+    for (int r = 0; r < nRhs; r++) {
+        sums[r] = sqrt(sums[r]);
+        largest = sums[r] > largest ? sums[r] : largest;
+    }
+
+    if (residualTimer) {
+        addTimerSample(residualTimer, timestamp() - start);
+    }
+
+    return largest;
+}
+
+/**
+ * @brief Function to do nSweeps batched Gauss Seidel sweeps.
+ *
+ * @param linSys Operator (unused, the systems are in the batch).
+ * @param opts Solver options.
+ * @param data Batch struct.
+ * @param nSweeps Number of sweeps.
+ * @return real_t Largest L2 norm of the residuals after the last sweep.
+ */
+static real_t batchGaussSeidelSweeps(linearSystem *linSys, const solverOptions *opts, void *data, int nSweeps) {
+    batchSystem *batch = (batchSystem *)data;
+
+    for (int t = 0; t < nSweeps; t++) {
+        batchGaussSeidelSweep(batch, opts->omega);
+    }
+
+    return batchL2Norm(batch);
+}
+
+/**
+ * @brief Batched Gauss Seidel (or SOR) function, the nRhs systems are swept together. The reported norm is the largest
+ * of the residual norms, so the tolerance applies to every system; the norms of the last check are left in
+ * batch->norms.
+ *
+ * @param batch Batch struct.
+ * @param opts Solver options.
+ * @param output Output file.
+ */
+void batchGaussSeidel(batchSystem *batch, const solverOptions *opts, FILE *output) {
+    iterativeSolve(&batch->op, opts, output, batchGaussSeidelSweeps, batch);
+    if (output) {
+        fprintf(output, "# Sistemas em lote: %d\n", batch->nRhs);
+    }
+}
+
+// void gaussSeidel(linearSystem *linSys, int it, FILE *output) {  // Loop unroll de 2.
+//     real_t itTime, *arrayL2Norm, acumItTime;
+//     int i, aux, k = 0;
+//     acumItTime = 0.0;
+//     arrayL2Norm = (real_t *)malloc(it * sizeof(real_t));
+
+//     LIKWID_MARKER_START("Gauss_Seidel_Likwid_Performance");
+//     while (k < it) {
+//         itTime = timestamp();
+//         i = 0;
+
+//         // primeira equação fora do laço
+//         linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx])) / linSys->md[i];
+
+//         // for  ate o inicio da diagonal inferior inferior
+//         aux = linSys->nx;
+//         aux -= aux % 2;
+//         for (i = 1; i < aux; i += 2) {
+//             linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) / linSys->md[i];
+//             linSys->x[i + 1] = (linSys->b[i + 1] - (linSys->sd[i + 1] * linSys->x[i + 2]) - (linSys->ssd[i + 1] * linSys->x[i + linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i])) / linSys->md[i + 1];
+//         }
+//         for (; i < linSys->nx; i++) {
+//             linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) / linSys->md[i];
+//         }
+
+//         // equações com todas as diagonais
+//         aux = linSys->nx * linSys->ny - linSys->nx;
+//         aux -= aux % 2;
+//         for (; i < aux; i += 2) {
+//             linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->iid[i] * linSys->x[i - linSys->nx])) / linSys->md[i];
+//             linSys->x[i + 1] = (linSys->b[i + 1] - (linSys->sd[i + 1] * linSys->x[i + 2]) - (linSys->ssd[i + 1] * linSys->x[i + linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i]) - (linSys->iid[i + 1] * linSys->x[i - linSys->nx + 1])) / linSys->md[i + 1];
+//         }
+//         for (; i < linSys->nx * linSys->ny - linSys->nx; i++) {
+//             linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->iid[i] * linSys->x[i - linSys->nx])) / linSys->md[i];
+//         }
+//         // for ate o final da diagonal inferior inferior
+//         aux = linSys->nx * linSys->ny - 1;
+//         aux -= aux % 2;
+//         for (; i < aux; i += 2) {
+//             linSys->x[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->sd[i] * linSys->x[i + 1])) / linSys->md[i];
+//             linSys->x[i + 1] = (linSys->b[i + 1] - (linSys->iid[i + 1] * linSys->x[i - linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i]) - (linSys->sd[i + 1] * linSys->x[i + 2])) / linSys->md[i + 1];
+//         }
+//         for (; i < linSys->nx * linSys->ny - 1; i++) {
+//             linSys->x[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->sd[i] * linSys->x[i + 1])) / linSys->md[i];
+//         }
+//         // ultima equação fora do laço
+//         linSys->x[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) / linSys->md[i];
+
+//         acumItTime += timestamp() - itTime;
+//         LIKWID_MARKER_START("L2_Norm_Likwid_Performance");
+//         arrayL2Norm[k] = l2Norm(linSys);
+//         LIKWID_MARKER_STOP("L2_Norm_Likwid_Performance");
+//         k++;
+//     }
+//     LIKWID_MARKER_STOP("Gauss_Seidel_Likwid_Performance");
+
+//     printGaussSeidelParameters(acumItTime / (it), arrayL2Norm, output, it);
+// }
+
+// void gaussSeidel(linearSystem *linSys, int it, FILE *output) {  // Loop unroll de 4.
+//     real_t itTime, *arrayL2Norm, acumItTime;
+//     int i, aux, k = 0;
+//     acumItTime = 0.0;
+//     arrayL2Norm = (real_t *)malloc(it * sizeof(real_t));
+
+//     LIKWID_MARKER_START("Gauss_Seidel_Likwid_Performance");
+//     while (k < it) {
+//         itTime = timestamp();
+//         i = 0;
+
+//         // primeira equação fora do laço
+//         linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx])) / linSys->md[i];
+
+//         // for  ate o inicio da diagonal inferior inferior
+//         aux = linSys->nx;
+//         aux -= aux % 4;
+//         for (i = 1; i < aux; i += 4) {
+//             linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) / linSys->md[i];
+//             linSys->x[i + 1] = (linSys->b[i + 1] - (linSys->sd[i + 1] * linSys->x[i + 2]) - (linSys->ssd[i + 1] * linSys->x[i + linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i])) / linSys->md[i + 1];
+//             linSys->x[i + 2] = (linSys->b[i + 2] - (linSys->sd[i + 2] * linSys->x[i + 3]) - (linSys->ssd[i + 2] * linSys->x[i + linSys->nx + 2]) - (linSys->id[i + 2] * linSys->x[i + 1])) / linSys->md[i + 2];
+//             linSys->x[i + 3] = (linSys->b[i + 3] - (linSys->sd[i + 3] * linSys->x[i + 4]) - (linSys->ssd[i + 3] * linSys->x[i + linSys->nx + 3]) - (linSys->id[i + 3] * linSys->x[i + 2])) / linSys->md[i + 3];
+//         }
+//         for (; i < linSys->nx; i++) {
+//             linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) / linSys->md[i];
+//         }
+
+//         // equações com todas as diagonais
+//         aux = linSys->nx * linSys->ny - linSys->nx;
+//         aux -= aux % 4;
+//         for (; i < aux; i += 4) {
+//             linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->iid[i] * linSys->x[i - linSys->nx])) / linSys->md[i];
+//             linSys->x[i + 1] = (linSys->b[i + 1] - (linSys->sd[i + 1] * linSys->x[i + 2]) - (linSys->ssd[i + 1] * linSys->x[i + linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i]) - (linSys->iid[i + 1] * linSys->x[i - linSys->nx + 1])) / linSys->md[i + 1];
+//             linSys->x[i + 2] = (linSys->b[i + 2] - (linSys->sd[i + 2] * linSys->x[i + 3]) - (linSys->ssd[i + 2] * linSys->x[i + linSys->nx + 2]) - (linSys->id[i + 2] * linSys->x[i + 1]) - (linSys->iid[i + 2] * linSys->x[i - linSys->nx + 2])) / linSys->md[i + 2];
+//             linSys->x[i + 3] = (linSys->b[i + 3] - (linSys->sd[i + 3] * linSys->x[i + 4]) - (linSys->ssd[i + 3] * linSys->x[i + linSys->nx + 3]) - (linSys->id[i + 3] * linSys->x[i + 2]) - (linSys->iid[i + 3] * linSys->x[i - linSys->nx + 3])) / linSys->md[i + 3];
+//         }
+//         for (; i < linSys->nx * linSys->ny - linSys->nx; i++) {
+//             linSys->x[i] = (linSys->b[i] - (linSys->sd[i] * linSys->x[i + 1]) - (linSys->ssd[i] * linSys->x[i + linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->iid[i] * linSys->x[i - linSys->nx])) / linSys->md[i];
+//         }
+//         // for ate o final da diagonal inferior inferior
+//         aux = linSys->nx * linSys->ny - 1;
+//         aux -= aux % 4;
+//         for (; i < aux; i += 4) {
+//             linSys->x[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->sd[i] * linSys->x[i + 1])) / linSys->md[i];
+//             linSys->x[i + 1] = (linSys->b[i + 1] - (linSys->iid[i + 1] * linSys->x[i - linSys->nx + 1]) - (linSys->id[i + 1] * linSys->x[i]) - (linSys->sd[i + 1] * linSys->x[i + 2])) / linSys->md[i + 1];
+//             linSys->x[i + 2] = (linSys->b[i + 2] - (linSys->iid[i + 2] * linSys->x[i - linSys->nx + 2]) - (linSys->id[i + 2] * linSys->x[i + 1]) - (linSys->sd[i + 2] * linSys->x[i + 3])) / linSys->md[i + 2];
+//             linSys->x[i + 3] = (linSys->b[i + 3] - (linSys->iid[i + 3] * linSys->x[i - linSys->nx + 3]) - (linSys->id[i + 3] * linSys->x[i + 2]) - (linSys->sd[i + 3] * linSys->x[i + 4])) / linSys->md[i + 3];
+//         }
+//         for (; i < linSys->nx * linSys->ny - 1; i++) {
+//             linSys->x[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1]) - (linSys->sd[i] * linSys->x[i + 1])) / linSys->md[i];
+//         }
+//         // ultima equação fora do laço
+//         linSys->x[i] = (linSys->b[i] - (linSys->iid[i] * linSys->x[i - linSys->nx]) - (linSys->id[i] * linSys->x[i - 1])) / linSys->md[i];
+
+//         acumItTime += timestamp() - itTime;
+//         LIKWID_MARKER_START("L2_Norm_Likwid_Performance");
+//         arrayL2Norm[k] = l2Norm(linSys);
+//         LIKWID_MARKER_STOP("L2_Norm_Likwid_Performance");
+//         k++;
+//     }
+//     LIKWID_MARKER_STOP("Gauss_Seidel_Likwid_Performance");
+
+//     printGaussSeidelParameters(acumItTime / (it), arrayL2Norm, output, it);
+// }
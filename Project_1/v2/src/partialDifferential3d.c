@@ -0,0 +1,468 @@
+#include <math.h>
+#include <omp.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "partialDifferential.h"
+#include "partialDifferential3d.h"
+#include "problems.h"
+
+#define BLOCK_3D_X 256  // Points in x of a tile of the 3D sweeps.
+#define BLOCK_3D_Y 16   // Points in y of a tile; three planes of a tile of x and one of b fit in a 256KB L2.
+#define ARENA_3D_ALIGNMENT 64             // Alignment of each array of the 3D system (cache line, AVX-512).
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)  // Alignment of the arena when huge pages are requested.
+#define PIPELINE_3D_MIN_ROWS 8  // Minimum rows of the row block of a thread of the pipelined 3D sweep.
+#define PIPELINE_3D_STRIDE 8    // Distance between the progress counters of the pipeline (one cache line).
+#define PIPELINE_3D_SPINS 4096  // Polls of a progress counter before the waiting thread yields its core.
+
+// The kernels below index the padded grid: point (i, j, k), 1 <= i <= nx and so on, is at IDX3D(i, j, k).
+#define IDX3D(i, j, k) (((size_t)(k) * (ny + 2) + (j)) * (nx + 2) + (i))
+
+/**
+ * @brief Function to return the bounds of tile "t" of a dimension with n interior points split in blocks of "block",
+ * widened to the halo points when the tile is on an edge.
+ *
+ * @param t Tile index.
+ * @param block Block size.
+ * @param n Interior points.
+ * @param lo First point (0 for the first tile).
+ * @param hi One past the last point (n + 2 for the last tile).
+ */
+static void haloTile(int t, int block, int n, int *lo, int *hi) {
+    *lo = t == 0 ? 0 : 1 + t * block;
+    *hi = 1 + (t + 1) * block >= n + 1 ? n + 2 : 1 + (t + 1) * block;
+}
+
+/**
+ * @brief Function to allocate a 3D system, "b" and "x" with their halo layers in one arena.
+ *
+ * The arena is zeroed by the OpenMP threads with the tile partition of the sweeps, so with first touch placement each
+ * thread finds its tiles on its own NUMA node.
+ *
+ * @param nx Number of points in x.
+ * @param ny Number of points in y.
+ * @param nz Number of points in z.
+ * @param hugePages If set the arena is backed by 2MB pages when the system allows it.
+ * @return linearSystem3d Linear system struct (arena is NULL if the allocation failed).
+ */
+linearSystem3d initLinearSystem3d(int nx, int ny, int nz, int hugePages) {
+    linearSystem3d linSys;
+    size_t points = (size_t)(nx + 2) * (ny + 2) * (nz + 2);
+    size_t slot = (points * sizeof(real_t) + ARENA_3D_ALIGNMENT - 1) / ARENA_3D_ALIGNMENT * ARENA_3D_ALIGNMENT, size = 2 * slot;
+    int tilesX = (nx + BLOCK_3D_X - 1) / BLOCK_3D_X, tilesY = (ny + BLOCK_3D_Y - 1) / BLOCK_3D_Y;
+
+    if (hugePages) {
+        size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    }
+
+    if (posix_memalign(&linSys.arena, hugePages ? HUGE_PAGE_SIZE : ARENA_3D_ALIGNMENT, size) != 0) {
+        linSys.arena = NULL;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (hugePages && linSys.arena) {
+        madvise(linSys.arena, size, MADV_HUGEPAGE);
+    }
+#endif
+
+    linSys.b = linSys.arena ? (real_t *)linSys.arena : NULL;
+    linSys.x = linSys.arena ? (real_t *)((char *)linSys.arena + slot) : NULL;
+
+    // First touch: each thread zeroes the tiles it sweeps, the halo layers go with the tiles next to them.
+    if (linSys.arena) {
+#pragma omp parallel for collapse(2) schedule(static)
+        for (int tj = 0; tj < tilesY; tj++) {
+            for (int ti = 0; ti < tilesX; ti++) {
+                int jLo, jHi, iLo, iHi;
+
+                haloTile(tj, BLOCK_3D_Y, ny, &jLo, &jHi);
+                haloTile(ti, BLOCK_3D_X, nx, &iLo, &iHi);
+
+                for (int k = 0; k < nz + 2; k++) {
+                    for (int j = jLo; j < jHi; j++) {
+                        memset(linSys.b + IDX3D(iLo, j, k), 0, (iHi - iLo) * sizeof(real_t));
+                        memset(linSys.x + IDX3D(iLo, j, k), 0, (iHi - iLo) * sizeof(real_t));
+                    }
+                }
+            }
+        }
+    }
+
+    linSys.prob = DEFAULT_PROBLEM_3D;
+    linSys.nx = nx;
+    linSys.ny = ny;
+    linSys.nz = nz;
+
+    return linSys;
+}
+
+/**
+ * @brief Function to free the arena of a 3D system.
+ *
+ * @param linSys Linear system struct.
+ */
+void freeLinearSystem3d(linearSystem3d *linSys) {
+    free(linSys->arena);
+
+    linSys->arena = NULL;
+    linSys->b = linSys->x = NULL;
+}
+
+/**
+ * @brief Function to set the stencil and the right-hand side of a 3D system from its problem.
+ *
+ * Centered differences are used for all the derivatives and the equation is not scaled. The known values of the
+ * neighbors on the faces are moved to the right-hand side.
+ *
+ * @param linSys Linear system struct.
+ */
+void setLinearSystem3d(linearSystem3d *linSys) {
+    const problem3d *prob = linSys->prob;
+    int nx = linSys->nx, ny = linSys->ny, nz = linSys->nz;
+    real_t hx = (prob->x1 - prob->x0) / (nx + 1), hy = (prob->y1 - prob->y0) / (ny + 1), hz = (prob->z1 - prob->z0) / (nz + 1);
+    stencil3d c;
+
+    // ------------------------------------------------ STENCIL COEFFICIENTS ------------------------------------------------
+
+    c.sd = -prob->kxx / (hx * hx) + prob->cx / (2 * hx);
+    c.id = -prob->kxx / (hx * hx) - prob->cx / (2 * hx);
+    c.ssd = -prob->kyy / (hy * hy) + prob->cy / (2 * hy);
+    c.iid = -prob->kyy / (hy * hy) - prob->cy / (2 * hy);
+    c.sssd = -prob->kzz / (hz * hz) + prob->cz / (2 * hz);
+    c.iiid = -prob->kzz / (hz * hz) - prob->cz / (2 * hz);
+    c.md = 2 * prob->kxx / (hx * hx) + 2 * prob->kyy / (hy * hy) + 2 * prob->kzz / (hz * hz) + prob->k0;
+    linSys->coef = c;
+
+    // ------------------------------------------------ FILL B ARRAY ------------------------------------------------
+
+#pragma omp parallel for schedule(static)
+    for (int k = 1; k <= nz; k++) {
+        real_t z = prob->z0 + k * hz;
+
+        for (int j = 1; j <= ny; j++) {
+            real_t y = prob->y0 + j * hy;
+
+            for (int i = 1; i <= nx; i++) {
+                real_t x = prob->x0 + i * hx, value = prob->source(x, y, z);
+
+                if (i == 1) {
+                    value -= c.id * prob->boundary(prob->x0, y, z);
+                }
+                if (i == nx) {
+                    value -= c.sd * prob->boundary(prob->x1, y, z);
+                }
+                if (j == 1) {
+                    value -= c.iid * prob->boundary(x, prob->y0, z);
+                }
+                if (j == ny) {
+                    value -= c.ssd * prob->boundary(x, prob->y1, z);
+                }
+                if (k == 1) {
+                    value -= c.iiid * prob->boundary(x, y, prob->z0);
+                }
+                if (k == nz) {
+                    value -= c.sssd * prob->boundary(x, y, prob->z1);
+                }
+
+                linSys->b[IDX3D(i, j, k)] = value;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Function to return the sum of the six off diagonal terms of the stencil at point p of the padded grid.
+ *
+ * @param c Stencil coefficients.
+ * @param x Solution.
+ * @param p Point index.
+ * @param row Distance between rows (nx + 2).
+ * @param plane Distance between planes ((nx + 2) * (ny + 2)).
+ * @return real_t
+ */
+static inline real_t offDiagonalProduct3d(const stencil3d *c, const real_t *x, size_t p, size_t row, size_t plane) {
+    return (c->id * x[p - 1] + c->sd * x[p + 1]) + (c->iid * x[p - row] + c->ssd * x[p + row]) + (c->iiid * x[p - plane] + c->sssd * x[p + plane]);
+}
+
+/**
+ * @brief Function to compute the L2 norm of the residual of a 3D system, split across OpenMP threads by tiles.
+ *
+ * @param linSys Linear system struct.
+ * @return real_t
+ */
+real_t l2Norm3d(const linearSystem3d *linSys) {
+    int nx = linSys->nx, ny = linSys->ny, nz = linSys->nz;
+    size_t row = nx + 2, plane = row * (ny + 2);
+    const real_t *x = linSys->x, *b = linSys->b;
+    stencil3d c = linSys->coef;
+    real_t result = 0.0;
+
+#pragma omp parallel for collapse(2) reduction(+ : result) schedule(static)
+    for (int jb = 1; jb <= ny; jb += BLOCK_3D_Y) {
+        for (int ib = 1; ib <= nx; ib += BLOCK_3D_X) {
+            int jEnd = jb + BLOCK_3D_Y <= ny ? jb + BLOCK_3D_Y : ny + 1, iEnd = ib + BLOCK_3D_X <= nx ? ib + BLOCK_3D_X : nx + 1;
+
+            for (int k = 1; k <= nz; k++) {
+                for (int j = jb; j < jEnd; j++) {
+                    for (int i = ib; i < iEnd; i++) {
+                        size_t p = IDX3D(i, j, k);
+                        real_t r = b[p] - offDiagonalProduct3d(&c, x, p, row, plane) - c.md * x[p];
+
+                        result += r * r;
+                    }
+                }
+            }
+        }
+    }
+
+    return sqrt(result);
+}
+
+// Shared state of the pipelined lexicographic 3D sweeps.
+typedef struct pipeline3d {
+    linearSystem3d *linSys;
+    long *progress;  // Planes finished by each thread in the current call, PIPELINE_3D_STRIDE apart.
+    int nThreads;    // Threads of the pipeline, each one owns a block of rows.
+} pipeline3d;
+
+/**
+ * @brief Function to spin until a progress counter of the 3D pipeline reaches target.
+ *
+ * @param counter Progress counter of another thread.
+ * @param target Value to wait for.
+ */
+static inline void waitPlanes(long *counter, long target) {
+    for (int spins = 0; __atomic_load_n(counter, __ATOMIC_ACQUIRE) < target; spins++) {
+        if (spins == PIPELINE_3D_SPINS) {
+            sched_yield();
+            spins = 0;
+        }
+    }
+}
+
+/**
+ * @brief Function to do the lexicographic Gauss Seidel update of rows j0 to j1 - 1 of plane k of a 3D system.
+ *
+ * @param linSys Linear system struct.
+ * @param k Plane.
+ * @param j0 First row.
+ * @param j1 One past the last row.
+ * @param omega Relaxation factor.
+ */
+static void gaussSeidelPlane3d(linearSystem3d *linSys, int k, int j0, int j1, real_t omega) {
+    int nx = linSys->nx, ny = linSys->ny;
+    size_t row = nx + 2, plane = row * (ny + 2);
+    real_t *x = linSys->x;
+    const real_t *b = linSys->b;
+    stencil3d c = linSys->coef;
+
+    for (int j = j0; j < j1; j++) {
+        for (int i = 1; i <= nx; i++) {
+            size_t p = IDX3D(i, j, k);
+            real_t gs = (b[p] - offDiagonalProduct3d(&c, x, p, row, plane)) / c.md;
+
+            x[p] = omega == 1.0 ? gs : x[p] + omega * (gs - x[p]);
+        }
+    }
+}
+
+/**
+ * @brief Function to do nSweeps lexicographic Gauss Seidel sweeps of a 3D system with the rows split across a pipeline
+ * of threads.
+ *
+ * Thread t owns a block of rows and updates it plane by plane. Its first row reads the last row of block t - 1 in the
+ * same plane, which must already be updated, and its last row reads the first row of block t + 1, which must not be
+ * updated yet in this sweep but must be in the previous one; the neighbors in the other planes are in its own block.
+ * So thread t starts plane k of sweep s once thread t - 1 has finished that plane and thread t + 1 has finished plane k
+ * of sweep s - 1, each thread trailing the one below by one plane. Every point then reads the same values as in the
+ * serial order, and the iterates are bitwise the ones of one thread. A thread reuses the three planes of its block from
+ * one plane to the next, so the block of the stencil stays in cache when the blocks are small enough.
+ *
+ * @param view Unused, the system is the 3D one.
+ * @param opts Solver options.
+ * @param data 3D pipeline struct.
+ * @param nSweeps Number of sweeps.
+ * @return real_t L2 norm of the residual after the last sweep.
+ */
+static real_t gaussSeidelSweeps3d(linearSystem *view, const solverOptions *opts, void *data, int nSweeps) {
+    pipeline3d *pl = (pipeline3d *)data;
+    linearSystem3d *linSys = pl->linSys;
+    int ny = linSys->ny, nz = linSys->nz;
+
+    (void)view;
+
+    for (int t = 0; t < pl->nThreads; t++) {
+        pl->progress[t * PIPELINE_3D_STRIDE] = 0;
+    }
+
+#pragma omp parallel num_threads(pl->nThreads)
+    {
+        int t = omp_get_thread_num(), n = omp_get_num_threads();
+        int j0 = 1 + (int)((long)t * ny / n), j1 = 1 + (int)((long)(t + 1) * ny / n);
+        long *mine = &pl->progress[t * PIPELINE_3D_STRIDE];
+        long *below = t > 0 ? mine - PIPELINE_3D_STRIDE : NULL, *above = t < n - 1 ? mine + PIPELINE_3D_STRIDE : NULL;
+
+        for (long plane = 0; plane < (long)nSweeps * nz; plane++) {
+            if (below) {
+                waitPlanes(below, plane + 1);
+            }
+            if (above) {
+                waitPlanes(above, plane + 1 - nz);
+            }
+
+            gaussSeidelPlane3d(linSys, 1 + (int)(plane % nz), j0, j1, opts->omega);
+            __atomic_store_n(mine, plane + 1, __ATOMIC_RELEASE);
+        }
+    }
+
+    return l2Norm3d(linSys);
+}
+
+/**
+ * @brief Function to update the points of one color (parity of i + j + k) of a 3D system.
+ *
+ * The grid is split in tiles of BLOCK_3D_X by BLOCK_3D_Y points, which the OpenMP threads sweep from the first plane to
+ * the last one. A color only reads the other one, so the order of the tiles does not change the iterates, and the three
+ * planes of a tile read by the stencil stay in cache from one plane to the next.
+ *
+ * @param linSys Linear system struct.
+ * @param color Color (0 is red, 1 is black).
+ * @param omega Relaxation factor.
+ */
+static void colorSweep3d(linearSystem3d *linSys, int color, real_t omega) {
+    int nx = linSys->nx, ny = linSys->ny, nz = linSys->nz;
+    size_t row = nx + 2, plane = row * (ny + 2);
+    real_t *x = linSys->x;
+    const real_t *b = linSys->b;
+    stencil3d c = linSys->coef;
+    real_t invMd = 1.0 / c.md;
+
+#pragma omp parallel for collapse(2) schedule(static)
+    for (int jb = 1; jb <= ny; jb += BLOCK_3D_Y) {
+        for (int ib = 1; ib <= nx; ib += BLOCK_3D_X) {
+            int jEnd = jb + BLOCK_3D_Y <= ny ? jb + BLOCK_3D_Y : ny + 1, iEnd = ib + BLOCK_3D_X <= nx ? ib + BLOCK_3D_X : nx + 1;
+
+            for (int k = 1; k <= nz; k++) {
+                for (int j = jb; j < jEnd; j++) {
+                    for (int i = ib + (ib + j + k + color) % 2; i < iEnd; i += 2) {
+                        size_t p = IDX3D(i, j, k);
+                        real_t gs = (b[p] - offDiagonalProduct3d(&c, x, p, row, plane)) * invMd;
+
+                        x[p] = omega == 1.0 ? gs : x[p] + omega * (gs - x[p]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Function to do nSweeps red-black sweeps of a 3D system.
+ *
+ * @param view Unused, the system is the 3D one.
+ * @param opts Solver options.
+ * @param data 3D linear system struct.
+ * @param nSweeps Number of sweeps.
+ * @return real_t L2 norm of the residual after the last sweep.
+ */
+static real_t redBlackSweeps3d(linearSystem *view, const solverOptions *opts, void *data, int nSweeps) {
+    linearSystem3d *linSys = (linearSystem3d *)data;
+
+    (void)view;
+
+    for (int t = 0; t < nSweeps; t++) {
+        colorSweep3d(linSys, 0, opts->omega);
+        colorSweep3d(linSys, 1, opts->omega);
+    }
+
+    return l2Norm3d(linSys);
+}
+
+/**
+ * @brief Function to run iterativeSolve() on a 3D system. The solver loop sees the padded grid as a 2D one of nx + 2 by
+ * (ny + 2) * (nz + 2) points, which is what the checkpoints store, with nz so that a 2D grid of the same size does not
+ * match them.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param output Output file.
+ * @param sweeps Sweep function of the method.
+ * @param data Method data passed to sweeps.
+ */
+static void iterativeSolve3d(linearSystem3d *linSys, const solverOptions *opts, FILE *output, sweepFunction sweeps, void *data) {
+    linearSystem view;
+
+    memset(&view, 0, sizeof(linearSystem));
+    view.b = linSys->b;
+    view.x = linSys->x;
+    view.matrixFree = 1;
+    view.nx = linSys->nx + 2;
+    view.ny = (linSys->ny + 2) * (linSys->nz + 2);
+    view.nz = linSys->nz;
+
+    iterativeSolve(&view, opts, output, sweeps, data);
+}
+
+/**
+ * @brief Lexicographic Gauss Seidel function for a 3D system, the sweep is split in row blocks across OpenMP threads.
+ *
+ * Each thread gets at least PIPELINE_3D_MIN_ROWS rows, so grids with few rows use fewer threads.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param output Output file.
+ */
+void gaussSeidel3d(linearSystem3d *linSys, const solverOptions *opts, FILE *output) {
+    pipeline3d pl;
+
+    pl.linSys = linSys;
+    pl.nThreads = linSys->ny / PIPELINE_3D_MIN_ROWS < omp_get_max_threads() ? linSys->ny / PIPELINE_3D_MIN_ROWS : omp_get_max_threads();
+    pl.nThreads = pl.nThreads > 0 ? pl.nThreads : 1;
+    pl.progress = (long *)calloc((size_t)pl.nThreads * PIPELINE_3D_STRIDE, sizeof(long));
+
+    iterativeSolve3d(linSys, opts, output, gaussSeidelSweeps3d, &pl);
+
+    if (output) {
+        fprintf(output, "# Threads do pipeline: %d\n", pl.nThreads);
+    }
+
+    free(pl.progress);
+}
+
+/**
+ * @brief Red-black Gauss Seidel function for a 3D system, cache blocked in x and y and split across OpenMP threads.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param output Output file.
+ */
+void redBlackGaussSeidel3d(linearSystem3d *linSys, const solverOptions *opts, FILE *output) {
+    iterativeSolve3d(linSys, opts, output, redBlackSweeps3d, linSys);
+}
+
+/**
+ * @brief Function to print the solution of a 3D system as "x y z value" lines.
+ *
+ * @param linSys Linear system struct.
+ * @param output Output file.
+ */
+void printMesh3d(const linearSystem3d *linSys, FILE *output) {
+    const problem3d *prob = linSys->prob;
+    int nx = linSys->nx, ny = linSys->ny, nz = linSys->nz;
+    real_t hx = (prob->x1 - prob->x0) / (nx + 1), hy = (prob->y1 - prob->y0) / (ny + 1), hz = (prob->z1 - prob->z0) / (nz + 1);
+
+    if (!output) {
+        output = stdout;
+    }
+
+    for (int k = 1; k <= nz; k++) {
+        for (int j = 1; j <= ny; j++) {
+            for (int i = 1; i <= nx; i++) {
+                fprintf(output, "%lf %lf %lf %lf\n", prob->x0 + i * hx, prob->y0 + j * hy, prob->z0 + k * hz, linSys->x[IDX3D(i, j, k)]);
+            }
+        }
+    }
+}
@@ -0,0 +1,325 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "instrumentation.h"
+#include "partialDifferential.h"
+#include "roofline.h"
+#include "simdKernels.h"
+#include "utils.h"
+
+#define BENCH_MAX_SIZES 64                                                         // Maximum number of grid sizes.
+#define BENCH_DEFAULT_SIZES "32,50,64,100,128,200,256,300,400,512,1000,1024,2000"  // Sizes of script.sh.
+
+// Solver variant measured by the benchmark.
+typedef struct benchVariant {
+    const char *name;
+    void (*solver)(linearSystem *linSys, const solverOptions *opts, FILE *output);
+    int matrixFree;
+    double bytesPerUpdate;  // Bytes one update has to move at least (the arrays it reads plus the write of x).
+    double flopsPerUpdate;  // Flops of one update (4 products, 4 subtractions and the division by the diagonal).
+    int singlePrecision;    // The sweeps compute in float, so the float roof applies.
+} benchVariant;
+
+/**
+ * @brief Function that evaluates the residual (l2Norm()) once per sweep, to measure the residual kernel alone.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param data Unused.
+ * @param nSweeps Number of evaluations.
+ * @return real_t L2 norm of the residual.
+ */
+static real_t residualSweeps(linearSystem *linSys, const solverOptions *opts, void *data, int nSweeps) {
+    real_t norm = 0.0;
+
+    (void)opts;
+    (void)data;
+
+    for (int t = 0; t < nSweeps; t++) {
+        norm = l2Norm(linSys);
+    }
+
+    return norm;
+}
+
+/**
+ * @brief Function to run residualSweeps() in the solver loop, so the residual kernel is timed as the sweeps are.
+ *
+ * @param linSys Linear system struct.
+ * @param opts Solver options.
+ * @param output Output file.
+ */
+static void residualKernel(linearSystem *linSys, const solverOptions *opts, FILE *output) {
+    iterativeSolve(linSys, opts, output, residualSweeps, NULL);
+}
+
+static const benchVariant variants[] = {
+    {"gs", gaussSeidel, 0, 8 * sizeof(real_t), 9, 0},              // 5 diagonals, b and x read, x written.
+    {"gs-mf", gaussSeidel, 1, 3 * sizeof(real_t), 9, 0},           // b and x read, x written.
+    {"pgs", pipelinedGaussSeidel, 0, 8 * sizeof(real_t), 9, 0},
+    {"pgs-mf", pipelinedGaussSeidel, 1, 3 * sizeof(real_t), 9, 0},
+    {"rb", redBlackGaussSeidel, 0, 8 * sizeof(real_t), 9, 0},
+    {"rb-mf", redBlackGaussSeidel, 1, 3 * sizeof(real_t), 9, 0},
+    {"wf", wavefrontGaussSeidel, 0, 8 * sizeof(real_t), 9, 0},
+    {"wf-mf", wavefrontGaussSeidel, 1, 3 * sizeof(real_t), 9, 0},
+    {"mp", mixedPrecisionGaussSeidel, 0, 8 * sizeof(float), 9, 1},  // Same arrays in float, multiplied by the inverse diagonal.
+    {"mp-mf", mixedPrecisionGaussSeidel, 1, 3 * sizeof(float), 9, 1},
+    {"l2", residualKernel, 0, 7 * sizeof(real_t), 12, 0},  // 5 diagonals, b and x read; 5 products, 5 subtractions, the square and the sum.
+    {"l2-mf", residualKernel, 1, 2 * sizeof(real_t), 12, 0},
+};
+
+#define N_VARIANTS ((int)(sizeof(variants) / sizeof(variants[0])))
+
+// Result of one variant on one grid size.
+typedef struct benchResult {
+    const benchVariant *variant;
+    int n;                 // Grid size (n x n).
+    double median, min;    // Time per sweep (ms).
+    double mlups, gbytes;  // Million lattice updates and effective gigabytes per second, from the median.
+} benchResult;
+
+/**
+ * @brief Function to measure one variant on an n x n grid.
+ *
+ * Each measurement starts from x = 0 and does opts->maxIt sweeps and one residual evaluation, after an untimed warm up
+ * run. Only the sweep chunks are timed (setChunkTimer()), so the setup of the method, such as the float copies of the
+ * mixed precision one, is left out. The report of the solver is discarded.
+ *
+ * @param variant Solver variant.
+ * @param n Grid size.
+ * @param opts Solver options.
+ * @param repeats Number of measurements.
+ * @param result Receives the result.
+ * @return int 0 on success, -1 if the system can not be allocated.
+ */
+static int measure(const benchVariant *variant, int n, const solverOptions *opts, int repeats, benchResult *result) {
+    linearSystem linSys = initLinearSystem(n, n, variant->matrixFree, 0);
+    timerRegion chunks = initTimerRegion("Varredura");
+    double *times;
+
+    if (!linSys.arena) {
+        return -1;
+    }
+
+    setLinearSystem(&linSys);
+    variant->solver(&linSys, opts, NULL);
+
+    // One sample per chunk: the time per sweep of the run is the mean of its chunks, weighted by their sweeps.
+    times = (double *)calloc(repeats, sizeof(double));
+    setChunkTimer(&chunks);
+    for (int r = 0; r < repeats; r++) {
+        int first = chunks.nSamples, done = 0;
+
+        memset(linSys.x, 0, (size_t)n * n * sizeof(real_t));
+        variant->solver(&linSys, opts, NULL);
+
+        for (int c = first; c < chunks.nSamples; c++) {
+            int nSweeps = opts->maxIt - done < opts->resEvery ? opts->maxIt - done : opts->resEvery;
+
+            times[r] += chunks.samples[c] * nSweeps / opts->maxIt;
+            done += nSweeps;
+        }
+    }
+    setChunkTimer(NULL);
+
+    qsort(times, repeats, sizeof(double), compareDouble);
+    *result = (benchResult){variant, n, 0.0, 0.0, 0.0, 0.0};
+    result->min = times[0];
+    result->median = repeats % 2 ? times[repeats / 2] : 0.5 * (times[repeats / 2 - 1] + times[repeats / 2]);
+    result->mlups = (double)n * n / (result->median * 1e3);
+    result->gbytes = result->mlups * variant->bytesPerUpdate / 1e3;
+
+    free(times);
+    freeTimerRegion(&chunks);
+    freeLinearSystem(&linSys);
+
+    return 0;
+}
+
+/**
+ * @brief Function to write one result as a CSV line or a JSON object.
+ *
+ * @param output Output file.
+ * @param result Result.
+ * @param json JSON instead of CSV.
+ * @param first First result (no separator before it).
+ */
+static void printResult(FILE *output, const benchResult *result, int json, int first) {
+    if (json) {
+        fprintf(output, "%s\n  {\"method\": \"%s\", \"nx\": %d, \"ny\": %d, \"median_ms\": %.6f, \"min_ms\": %.6f, \"mlups\": %.3f, \"gbs\": %.3f}", first ? "" : ",", result->variant->name, result->n, result->n, result->median, result->min, result->mlups, result->gbytes);
+    } else {
+        fprintf(output, "%s,%d,%d,%.6f,%.6f,%.3f,%.3f\n", result->variant->name, result->n, result->n, result->median, result->min, result->mlups, result->gbytes);
+    }
+    fflush(output);
+}
+
+/**
+ * @brief Function to write the roofline header: the measured roofs of the machine and the ridge point.
+ *
+ * @param output Output file.
+ * @param peaks Roofs of the machine.
+ */
+static void printRooflineHeader(FILE *output, const machinePeaks *peaks) {
+    fprintf(output, "# Banda de memória (STREAM triad): %.2f GB/s\n", peaks->bandwidth);
+    fprintf(output, "# Pico de %s: %.2f GFLOP/s (double), %.2f GFLOP/s (float)\n", peaks->probe, peaks->flops, peaks->floatFlops);
+    fprintf(output, "# Ponto de cumeeira: %.3f FLOP/B (double), %.3f FLOP/B (float)\n", peaks->flops / peaks->bandwidth, peaks->floatFlops / peaks->bandwidth);
+    fprintf(output, "#método       n       FLOP/B      GFLOP/s    atingível   fração  limite\n");
+    fflush(output);
+}
+
+/**
+ * @brief Function to write one result against the roofline: the arithmetic intensity of the kernel, the achieved and
+ * attainable GFLOP/s, the fraction of the attainable reached and the roof that bounds the kernel. The float variants
+ * are measured against the float roof.
+ *
+ * @param output Output file.
+ * @param result Result.
+ * @param peaks Roofs of the machine.
+ */
+static void printRooflineResult(FILE *output, const benchResult *result, const machinePeaks *peaks) {
+    double intensity = result->variant->flopsPerUpdate / result->variant->bytesPerUpdate;
+    double achieved = result->mlups * result->variant->flopsPerUpdate / 1e3, attainable = attainableFlops(peaks, intensity, result->variant->singlePrecision);
+    double computeRoof = result->variant->singlePrecision ? peaks->floatFlops : peaks->flops;
+
+    fprintf(output, "%-8s %6d %12.4f %12.3f %12.3f %7.1f%%  %s\n", result->variant->name, result->n, intensity, achieved, attainable, 100.0 * achieved / attainable, intensity * peaks->bandwidth < computeRoof ? "memória" : "computação");
+    fflush(output);
+}
+
+/**
+ * @brief Function to tell whether a variant is in a comma separated list (NULL selects all).
+ *
+ * @param list List of names.
+ * @param name Variant name.
+ * @return int
+ */
+static int selected(const char *list, const char *name) {
+    size_t length = strlen(name);
+
+    for (const char *p = list; p; p = strchr(p, ',') ? strchr(p, ',') + 1 : NULL) {
+        if (strncmp(p, name, length) == 0 && (p[length] == ',' || p[length] == '\0')) {
+            return 1;
+        }
+    }
+
+    return list == NULL;
+}
+
+int main(int argc, char *argv[]) {
+    int arg, badArg = 0, repeats = 5, nSizes = 0, sizes[BENCH_MAX_SIZES], json = 0, first = 1, nSelected = 0, roofline = 0;
+    solverOptions opts = {10, 0.0, 10, 4, 1.0, V_CYCLE, 0, NULL, 0, NULL, 0};
+    char *sizeList = BENCH_DEFAULT_SIZES, *methodList = NULL, *outputFileName = NULL;
+    FILE *outputFile = stdout;
+    machinePeaks peaks;
+
+    LIKWID_MARKER_INIT;
+    initSimdKernels();
+
+    for (arg = 1; arg < argc; arg++) {
+        if (strcmp("-s", argv[arg]) == 0) {
+            arg++;
+            sizeList = argv[arg];
+        }
+
+        if (strcmp("-i", argv[arg]) == 0) {
+            arg++;
+            opts.maxIt = opts.resEvery = atoi(argv[arg]);
+        }
+
+        if (strcmp("-n", argv[arg]) == 0) {
+            arg++;
+            repeats = atoi(argv[arg]);
+        }
+
+        if (strcmp("-d", argv[arg]) == 0) {
+            arg++;
+            opts.depth = atoi(argv[arg]);
+        }
+
+        if (strcmp("-m", argv[arg]) == 0) {
+            arg++;
+            methodList = argv[arg];
+        }
+
+        if (strcmp("-o", argv[arg]) == 0) {
+            arg++;
+            outputFileName = argv[arg];
+        }
+
+        if (strcmp("-f", argv[arg]) == 0) {
+            arg++;
+            if (strcmp("json", argv[arg]) == 0) {
+                json = 1;
+            } else if (strcmp("csv", argv[arg]) != 0) {
+                badArg = 1;
+            }
+        }
+
+        if (strcmp("--roofline", argv[arg]) == 0) {
+            roofline = 1;
+        }
+    }
+
+    for (char *p = sizeList; p && nSizes < BENCH_MAX_SIZES; p = strchr(p, ',') ? strchr(p, ',') + 1 : NULL) {
+        sizes[nSizes] = atoi(p);
+        badArg |= sizes[nSizes++] < 3;
+    }
+
+    for (int v = 0; v < N_VARIANTS; v++) {
+        nSelected += selected(methodList, variants[v].name);
+    }
+
+    if (badArg || nSelected == 0 || opts.maxIt <= 0 || repeats <= 0 || opts.depth <= 0) {
+        fprintf(stderr, "Argumentos incorretos. O formato deve ser: \"pdeBench [-s n1,n2,...] [-i <sweeps>] [-n <repetições>] [-d <depth>] [-m gs,gs-mf,pgs,pgs-mf,rb,rb-mf,wf,wf-mf,mp,mp-mf,l2,l2-mf] [-f csv|json] [--roofline] [-o arquivo_saida]\".\n");
+        return -1;
+    }
+
+    if (outputFileName) {
+        outputFile = fopen(outputFileName, "w");
+        if (!outputFile) {
+            fprintf(stderr, "Erro ao abrir \"%s\".\n", outputFileName);
+            return -1;
+        }
+    }
+
+    if (roofline) {
+        peaks = measureMachinePeaks();
+        printRooflineHeader(outputFile, &peaks);
+    } else if (json) {
+        fprintf(outputFile, "[");
+    } else {
+        fprintf(outputFile, "method,nx,ny,median_ms,min_ms,mlups,gbs\n");
+    }
+
+    for (int s = 0; s < nSizes; s++) {
+        for (int v = 0; v < N_VARIANTS; v++) {
+            if (selected(methodList, variants[v].name)) {
+                benchResult result;
+
+                if (measure(&variants[v], sizes[s], &opts, repeats, &result) != 0) {
+                    fprintf(stderr, "Erro ao alocar o sistema linear (%d x %d).\n", sizes[s], sizes[s]);
+                    continue;
+                }
+
+                if (roofline) {
+                    printRooflineResult(outputFile, &result, &peaks);
+                } else {
+                    printResult(outputFile, &result, json, first);
+                }
+                first = 0;
+            }
+        }
+    }
+
+    if (json && !roofline) {
+        fprintf(outputFile, "\n]\n");
+    }
+
+    if (outputFile != stdout) {
+        fclose(outputFile);
+    }
+
+    LIKWID_MARKER_CLOSE;
+
+    return 0;
+}
@@ -1,57 +1,433 @@
-#include <likwid.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include "partialDifferential.h"
-
-int main(int argc, char *argv[]) {
-    int nx, ny, it, arg;
-    char *outputFileName;
-    FILE *outputFile = NULL;
-
-    LIKWID_MARKER_INIT;
-
-    nx = ny = it = 0;
-
-    for (arg = 1; arg < argc; arg++) {
-        if (strcmp("-nx", argv[arg]) == 0) {
-            arg++;
-            nx = atoi(argv[arg]);
-        }
-
-        if (strcmp("-ny", argv[arg]) == 0) {
-            arg++;
-            ny = atoi(argv[arg]);
-        }
-
-        if (strcmp("-i", argv[arg]) == 0) {
-            arg++;
-            it = atoi(argv[arg]);
-        }
-
-        if (strcmp("-o", argv[arg]) == 0) {
-            arg++;
-            outputFileName = argv[arg];
-            outputFile = fopen(outputFileName, "w");
-        }
-    }
-
-    if (nx > 0 && ny > 0 && it > 0) {
-        linearSystem linSys = initLinearSystem(nx, ny);
-
-        setLinearSystem(&linSys);
-
-        gaussSeidel(&linSys, it, outputFile);
-
-        printMesh(&linSys, outputFile);
-
-    } else {
-        fprintf(stderr, "Argumentos incorretos. O formato deve ser: \"pdeSolver -nx <Nx> -ny <Ny> -i <maxIter> -o arquivo_saida\".\n");
-
-        return -1;
-    }
-
-    LIKWID_MARKER_CLOSE;
-
-    return 0;
-}
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "instrumentation.h"
+#include "partialDifferential.h"
+#include "partialDifferential3d.h"
+#include "problems.h"
+#include "simdKernels.h"
+#include "utils.h"
+
+#ifdef USE_MPI
+#include "mpiSolver.h"
+#endif
+
+#ifndef USE_MPI
+/**
+ * @brief Function to solve nRhs systems of the mesh at once, right-hand side r being (r + 1) times the one of
+ * setLinearSystem(), and write the solution of the first one.
+ *
+ * @param nx Number of points in x.
+ * @param ny Number of points in y.
+ * @param nRhs Number of right-hand sides.
+ * @param prob Problem.
+ * @param matrixFree No diagonal arrays.
+ * @param hugePages Back the operator with 2MB pages.
+ * @param opts Solver options.
+ * @param outputFile Output file.
+ * @param binaryFileName Binary mesh file, or NULL for the text mesh in outputFile.
+ * @return int Exit code.
+ */
+static int solveBatch(int nx, int ny, int nRhs, const problem *prob, int matrixFree, int hugePages, const solverOptions *opts, FILE *outputFile, const char *binaryFileName) {
+    batchSystem batch = initBatchSystem(nx, ny, nRhs, matrixFree, hugePages);
+
+    if (!batch.x) {
+        fprintf(stderr, "Erro ao alocar os %d sistemas lineares (%d x %d).\n", nRhs, nx, ny);
+        freeBatchSystem(&batch);
+        return -1;
+    }
+
+    batch.op.prob = prob;
+    setLinearSystem(&batch.op);
+
+    for (int r = 0; r < nRhs; r++) {
+        for (int k = 0; k < nx * ny; k++) {
+            batch.op.x[k] = (r + 1) * batch.op.b[k];
+        }
+        setBatchRightHandSide(&batch, r, batch.op.x);
+    }
+
+    batchGaussSeidel(&batch, opts, outputFile);
+    getBatchSolution(&batch, 0, batch.op.x);
+
+    int status = 0;
+    if (binaryFileName) {
+        if (writeMeshBinary(&batch.op, binaryFileName) != 0) {
+            fprintf(stderr, "Erro ao escrever a malha em \"%s\".\n", binaryFileName);
+            status = -1;
+        }
+    } else {
+        printMesh(&batch.op, outputFile);
+    }
+
+    freeBatchSystem(&batch);
+
+    return status;
+}
+
+/**
+ * @brief Function to solve the system of an nx * ny * nz grid and write its solution.
+ *
+ * @param nx Number of points in x.
+ * @param ny Number of points in y.
+ * @param nz Number of points in z.
+ * @param prob Problem.
+ * @param method GAUSS_SEIDEL or RED_BLACK.
+ * @param hugePages Back the arena with 2MB pages.
+ * @param opts Solver options.
+ * @param outputFile Output file.
+ * @return int Exit code.
+ */
+static int solve3d(int nx, int ny, int nz, const problem3d *prob, solverMethod method, int hugePages, const solverOptions *opts, FILE *outputFile) {
+    linearSystem3d linSys = initLinearSystem3d(nx, ny, nz, hugePages);
+
+    if (!linSys.arena) {
+        fprintf(stderr, "Erro ao alocar o sistema linear (%d x %d x %d).\n", nx, ny, nz);
+        return -1;
+    }
+
+    linSys.prob = prob;
+    setLinearSystem3d(&linSys);
+
+    if (method == RED_BLACK) {
+        redBlackGaussSeidel3d(&linSys, opts, outputFile);
+    } else {
+        gaussSeidel3d(&linSys, opts, outputFile);
+    }
+
+    printMesh3d(&linSys, outputFile);
+    freeLinearSystem3d(&linSys);
+
+    return 0;
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    int nx, ny, nz = 0, arg, badArg = 0, matrixFree = 0, hugePages = 0, sequence = 0;
+    real_t sequenceTime = 0.0;
+    solverOptions opts = {0, 0.0, 1, 4, 1.0, V_CYCLE, 0, NULL, 0, NULL, 0};
+    solverMethod method = GAUSS_SEIDEL;
+    const problem *prob = DEFAULT_PROBLEM;
+    const problem3d *prob3d = DEFAULT_PROBLEM_3D;
+    char *problemName = NULL;
+    int binaryMesh = 0, nRhs = 0;
+    char *outputFileName = NULL;
+    FILE *outputFile = NULL;
+
+#ifdef USE_MPI
+    int rank, size, provided;
+
+    // MPI is only called outside of the OpenMP parallel regions.
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    method = RED_BLACK;
+#endif
+
+    LIKWID_MARKER_INIT;
+    initSimdKernels();
+
+    nx = ny = 0;
+
+    for (arg = 1; arg < argc; arg++) {
+        if (strcmp("-nx", argv[arg]) == 0) {
+            arg++;
+            nx = atoi(argv[arg]);
+        }
+
+        if (strcmp("-ny", argv[arg]) == 0) {
+            arg++;
+            ny = atoi(argv[arg]);
+        }
+
+        if (strcmp("-nz", argv[arg]) == 0) {
+            arg++;
+            nz = atoi(argv[arg]);
+            badArg |= nz < 1;
+        }
+
+        if (strcmp("-i", argv[arg]) == 0) {
+            arg++;
+            opts.maxIt = atoi(argv[arg]);
+        }
+
+        if (strcmp("-t", argv[arg]) == 0) {
+            arg++;
+            opts.tol = atof(argv[arg]);
+        }
+
+        if (strcmp("-r", argv[arg]) == 0) {
+            arg++;
+            opts.resEvery = atoi(argv[arg]);
+        }
+
+        if (strcmp("-m", argv[arg]) == 0) {
+            arg++;
+            if (strcmp("rb", argv[arg]) == 0) {
+                method = RED_BLACK;
+            } else if (strcmp("bicgstab", argv[arg]) == 0) {
+                method = BICGSTAB;
+            } else if (strcmp("mg", argv[arg]) == 0) {
+                method = MULTIGRID;
+            } else if (strcmp("wf", argv[arg]) == 0) {
+                method = WAVEFRONT;
+            } else if (strcmp("gs", argv[arg]) == 0) {
+                method = GAUSS_SEIDEL;
+            } else if (strcmp("mp", argv[arg]) == 0) {
+                method = MIXED_PRECISION;
+            } else if (strcmp("pgs", argv[arg]) == 0) {
+                method = PIPELINED;
+            } else {
+                badArg = 1;
+            }
+        }
+
+        if (strcmp("-w", argv[arg]) == 0) {
+            arg++;
+            if (strcmp("auto", argv[arg]) == 0) {
+                opts.omega = SOR_AUTO_OMEGA;
+            } else {
+                opts.omega = atof(argv[arg]);
+                if (opts.omega <= 0.0 || opts.omega >= 2.0) {
+                    badArg = 1;
+                }
+            }
+        }
+
+        if (strcmp("-c", argv[arg]) == 0) {
+            arg++;
+            if (strcmp("v", argv[arg]) == 0) {
+                opts.cycle = V_CYCLE;
+            } else if (strcmp("f", argv[arg]) == 0) {
+                opts.cycle = F_CYCLE;
+            } else {
+                badArg = 1;
+            }
+        }
+
+        if (strcmp("-d", argv[arg]) == 0) {
+            arg++;
+            opts.depth = atoi(argv[arg]);
+        }
+
+        if (strcmp("-p", argv[arg]) == 0) {
+            opts.precondition = 1;
+        }
+
+        if (strcmp("-mf", argv[arg]) == 0) {
+            matrixFree = 1;
+        }
+
+        if (strcmp("-k", argv[arg]) == 0) {
+            arg++;
+            nRhs = atoi(argv[arg]);
+            badArg |= nRhs < 1;
+        }
+
+        if (strcmp("-a", argv[arg]) == 0) {
+            opts.asyncResidual = 1;
+        }
+
+        if (strcmp("-hp", argv[arg]) == 0) {
+            hugePages = 1;
+        }
+
+        if (strcmp("-o", argv[arg]) == 0) {
+            arg++;
+            outputFileName = argv[arg];
+        }
+
+        if (strcmp("--checkpoint", argv[arg]) == 0) {
+            arg++;
+            opts.checkpointFile = argv[arg];
+        }
+
+        if (strcmp("--every", argv[arg]) == 0) {
+            arg++;
+            opts.checkpointEvery = atoi(argv[arg]);
+        }
+
+        if (strcmp("--restart", argv[arg]) == 0) {
+            arg++;
+            opts.restartFile = argv[arg];
+        }
+
+        if (strcmp("--sequence", argv[arg]) == 0) {
+            arg++;
+            sequence = atoi(argv[arg]);
+            badArg |= sequence < 1;
+        }
+
+        if (strcmp("--problem", argv[arg]) == 0) {
+            arg++;
+            problemName = argv[arg];
+        }
+
+        if (strcmp("-f", argv[arg]) == 0) {
+            arg++;
+            if (strcmp("bin", argv[arg]) == 0) {
+                binaryMesh = 1;
+            } else if (strcmp("txt", argv[arg]) != 0) {
+                badArg = 1;
+            }
+        }
+    }
+
+    // The 2D and 3D problems have separate tables.
+    if (problemName && nz > 0) {
+        prob3d = findProblem3d(problemName);
+        badArg |= !prob3d;
+    } else if (problemName) {
+        prob = findProblem(problemName);
+        badArg |= !prob;
+    }
+
+    // The 3D grid has the lexicographic and red-black Gauss Seidel methods, and only the text mesh.
+    if (nz > 0 && ((method != GAUSS_SEIDEL && method != RED_BLACK) || nRhs > 0 || binaryMesh)) {
+        badArg = 1;
+    }
+
+    // Only the lexicographic sweeps leave the residual to the helper thread.
+    if (opts.asyncResidual && ((method != GAUSS_SEIDEL && method != PIPELINED) || nRhs > 0 || nz > 0)) {
+        badArg = 1;
+    }
+
+    // The grid sequencing sets the initial guess of a single 2D system, which a restart would overwrite. The coarse grids
+    // stop at the rescaled tolerance, so without -t each one would run the full -i sweeps and save none on the fine grid.
+    if (sequence > 0 && (nRhs > 0 || nz > 0 || opts.restartFile || opts.tol <= 0.0)) {
+        badArg = 1;
+    }
+
+    // The batched solve is a Gauss Seidel one and its state does not fit the checkpoints.
+    if (nRhs > 0 && (method != GAUSS_SEIDEL || opts.checkpointFile || opts.restartFile)) {
+        badArg = 1;
+    }
+
+#ifdef USE_MPI
+    // Only the red-black ordering is distributed, and every rank needs at least one row. The slabs are always
+    // matrix-free, so -mf has no effect. The checkpoints hold the whole mesh and are not supported.
+    if (method != RED_BLACK || ny < size || opts.checkpointFile || opts.restartFile || nRhs > 0 || nz > 0 || sequence > 0) {
+        badArg = 1;
+    }
+    (void)matrixFree;
+    (void)sequenceTime;
+#endif
+
+    // The row kernels read the neighbours of the first and last rows and columns, so both dimensions need 2 points.
+    if (nx > 1 && ny > 1 && opts.maxIt > 0 && opts.tol >= 0.0 && opts.resEvery > 0 && opts.depth > 0 && (!opts.checkpointFile || opts.checkpointEvery > 0) && !badArg && !(binaryMesh && !outputFileName)) {
+#ifdef USE_MPI
+        // With the binary mesh the file only holds the mesh and the report goes to stdout. Only rank 0 writes the report.
+        outputFile = rank == 0 ? ((outputFileName && !binaryMesh) ? fopen(outputFileName, "w") : stdout) : NULL;
+
+        mpiSlab slab = initMpiSlab(nx, ny, prob, hugePages);
+
+        if (!slab.local.arena) {
+            fprintf(stderr, "Erro ao alocar o sistema linear do processo %d.\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, -1);
+        }
+
+        mpiRedBlackGaussSeidel(&slab, &opts, outputFile);
+
+        if (binaryMesh) {
+            if (writeMpiMeshBinary(&slab, outputFileName) != 0) {
+                if (rank == 0) {
+                    fprintf(stderr, "Erro ao escrever a malha em \"%s\".\n", outputFileName);
+                }
+                MPI_Finalize();
+                return -1;
+            }
+        } else {
+            printMpiMesh(&slab, outputFile);
+        }
+
+        freeMpiSlab(&slab);
+#else
+        // With the binary mesh the file only holds the mesh and the report goes to stdout.
+        outputFile = (outputFileName && !binaryMesh) ? fopen(outputFileName, "w") : stdout;
+
+        if (nRhs > 0) {
+            int status = solveBatch(nx, ny, nRhs, prob, matrixFree, hugePages, &opts, outputFile, binaryMesh ? outputFileName : NULL);
+
+            LIKWID_MARKER_CLOSE;
+            return status;
+        }
+
+        if (nz > 0) {
+            int status = solve3d(nx, ny, nz, prob3d, method, hugePages, &opts, outputFile);
+
+            LIKWID_MARKER_CLOSE;
+            return status;
+        }
+
+        linearSystem linSys = initLinearSystem(nx, ny, matrixFree, hugePages);
+
+        if (!linSys.arena) {
+            fprintf(stderr, "Erro ao alocar o sistema linear (%d x %d).\n", nx, ny);
+            return -1;
+        }
+
+        linSys.prob = prob;
+        setLinearSystem(&linSys);
+
+        void (*solver)(linearSystem *, const solverOptions *, FILE *) = gaussSeidel;
+
+        if (method == RED_BLACK) {
+            solver = redBlackGaussSeidel;
+        } else if (method == BICGSTAB) {
+            solver = bicgstabSolver;
+        } else if (method == MULTIGRID) {
+            solver = multigridSolver;
+        } else if (method == WAVEFRONT) {
+            solver = wavefrontGaussSeidel;
+        } else if (method == MIXED_PRECISION) {
+            solver = mixedPrecisionGaussSeidel;
+        } else if (method == PIPELINED) {
+            solver = pipelinedGaussSeidel;
+        }
+
+        // The coarse grids are solved before the fine one and their time is reported after its table.
+        if (sequence > 0) {
+            sequenceTime = timestamp();
+            sequence = sequenceInitialGuess(&linSys, &opts, sequence, solver);
+            sequenceTime = timestamp() - sequenceTime;
+        }
+
+        solver(&linSys, &opts, outputFile);
+
+        if (sequence > 0) {
+            fprintf(outputFile, "# Sequência de malhas: %d níveis grossos em %lfms\n", sequence, sequenceTime);
+        }
+
+        if (binaryMesh) {
+            if (writeMeshBinary(&linSys, outputFileName) != 0) {
+                fprintf(stderr, "Erro ao escrever a malha em \"%s\".\n", outputFileName);
+                return -1;
+            }
+        } else {
+            printMesh(&linSys, outputFile);
+        }
+
+        freeLinearSystem(&linSys);
+#endif
+
+    } else {
+#ifdef USE_MPI
+        if (rank == 0) {
+            fprintf(stderr, "Argumentos incorretos. O formato deve ser: \"mpirun -np <p> pdeSolverMpi -nx <Nx> -ny <Ny> -i <maxIter> [-t <tol>] [-r <k>] [-w <omega>|auto] [-m rb] [-hp] [--problem sinh|poisson|laplace] [-f txt|bin] -o arquivo_saida\", com Nx >= 2 e Ny >= max(p, 2).\n");
+        }
+        MPI_Finalize();
+#else
+        fprintf(stderr, "Argumentos incorretos. O formato deve ser: \"pdeSolver -nx <Nx> -ny <Ny> [-nz <Nz>] -i <maxIter> [-t <tol>] [-r <k>] [-w <omega>|auto] [-m gs|pgs|rb|wf|mg|bicgstab|mp] [-d <depth>] [-c v|f] [-p] [-a] [-mf] [-hp] [-k <nRhs>] [--checkpoint <arquivo> --every <k>] [--restart <arquivo>] [--sequence <níveis>] [--problem sinh|poisson|laplace] [-f txt|bin] -o arquivo_saida\", com Nx, Ny >= 2. Com -nz: -m gs|rb, --problem poisson|laplace|conveccao e -f txt. --sequence requer -t (as malhas grossas param na tolerância).\n");
+#endif
+
+        return -1;
+    }
+
+    LIKWID_MARKER_CLOSE;
+
+#ifdef USE_MPI
+    MPI_Finalize();
+#endif
+
+    return 0;
+}
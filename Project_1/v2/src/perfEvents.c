@@ -0,0 +1,298 @@
+#include <cpuid.h>
+#include <linux/perf_event.h>
+#include <omp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "instrumentation.h"
+#include "utils.h"
+
+#define PERF_MAX_REGIONS 16  // Distinct region names.
+#define PERF_NAME_SIZE 64    // Region name length.
+
+// Counter opened by perfMarkerInit() on every OpenMP thread. The FP events are the Intel FP_ARITH_INST_RETIRED umasks
+// (Broadwell and later); they are only opened on Intel CPUs, since the same raw codes mean other events elsewhere, and
+// where they do not exist the open fails. Either way the FP ops are reported as unavailable.
+typedef struct perfCounter {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+    int flops;      // Floating point operations per counted instruction (0 for the other counters).
+    int intelOnly;  // Raw Intel event.
+    int open;       // Open on every thread.
+} perfCounter;
+
+static perfCounter counters[] = {
+    {"task clock (ns)", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, 0, 0, 0},  // Available without a PMU (VMs).
+    {"ciclos", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, 0, 0, 0},
+    {"instruções", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, 0, 0, 0},
+    {"cache misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, 0, 0, 0},
+    {"fp scalar", PERF_TYPE_RAW, 0x01c7, 1, 1, 0},
+    {"fp 128", PERF_TYPE_RAW, 0x04c7, 2, 1, 0},
+    {"fp 256", PERF_TYPE_RAW, 0x10c7, 4, 1, 0},
+    {"fp 512", PERF_TYPE_RAW, 0x40c7, 8, 1, 0},
+};
+
+#define N_COUNTERS ((int)(sizeof(counters) / sizeof(counters[0])))
+
+// Value of a counter with the times it was enabled and running (PERF_FORMAT_TOTAL_TIME_ENABLED | _RUNNING).
+typedef struct perfReading {
+    uint64_t value, enabled, running;
+} perfReading;
+
+// Accumulated counts of one region.
+typedef struct perfRegion {
+    char name[PERF_NAME_SIZE];
+    int calls;
+    double time, startTime;          // ms.
+    double count[N_COUNTERS];        // Accumulated deltas, summed over the threads and scaled when multiplexed.
+    int multiplexed[N_COUNTERS];     // Some delta was scaled.
+    perfReading *start;              // Readings at the open start (nThreads * N_COUNTERS).
+} perfRegion;
+
+static perfRegion regions[PERF_MAX_REGIONS];
+static int nRegions = 0;
+
+static int *fds = NULL;  // Descriptor of counter c on thread t at [t * N_COUNTERS + c] (-1 if not open).
+static int nThreads = 0;
+
+/**
+ * @brief Function to tell whether the CPU is an Intel one, from the CPUID vendor string.
+ *
+ * @return int
+ */
+static int intelCpu(void) {
+    unsigned int eax, ebx, ecx, edx;
+    char vendor[13];
+
+    if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+
+    memcpy(vendor, &ebx, 4);
+    memcpy(vendor + 4, &edx, 4);
+    memcpy(vendor + 8, &ecx, 4);
+    vendor[12] = '\0';
+
+    return strcmp(vendor, "GenuineIntel") == 0;
+}
+
+/**
+ * @brief Function to read a counter of a thread (zeros if it is not open).
+ *
+ * @param t Thread.
+ * @param c Counter.
+ * @return perfReading
+ */
+static perfReading readCounter(int t, int c) {
+    perfReading reading = {0, 0, 0};
+    int fd = fds[t * N_COUNTERS + c];
+
+    if (fd >= 0 && read(fd, &reading, sizeof(reading)) != sizeof(reading)) {
+        memset(&reading, 0, sizeof(reading));
+    }
+
+    return reading;
+}
+
+/**
+ * @brief Function to find a region by name, creating it on first use.
+ *
+ * @param name Region name.
+ * @return perfRegion* NULL when there are already PERF_MAX_REGIONS regions or the counters were not initialized.
+ */
+static perfRegion *findRegion(const char *name) {
+    for (int r = 0; r < nRegions; r++) {
+        if (strcmp(regions[r].name, name) == 0) {
+            return &regions[r];
+        }
+    }
+
+    if (nRegions == PERF_MAX_REGIONS || !fds) {
+        return NULL;
+    }
+
+    memset(&regions[nRegions], 0, sizeof(perfRegion));
+    strncpy(regions[nRegions].name, name, PERF_NAME_SIZE - 1);
+    regions[nRegions].start = (perfReading *)calloc((size_t)nThreads * N_COUNTERS, sizeof(perfReading));
+    if (!regions[nRegions].start) {
+        return NULL;
+    }
+
+    return &regions[nRegions++];
+}
+
+/**
+ * @brief Function to open the counters on every OpenMP thread, user space only so it works with perf_event_paranoid 2.
+ *
+ * Each thread of a parallel region opens its own set (pid 0), and a read sums the sets, so the counts of the threads
+ * are complete while they run (an inherited counter only adds a child thread when it exits). OpenMP keeps its threads
+ * between regions, so the sets stay attached to them. Other threads (the residual monitor, the checkpoint writer) are
+ * not counted. A counter that can not be opened on every thread is closed and reported as unavailable.
+ */
+void perfMarkerInit(void) {
+    int intel = intelCpu(), nOpen = 0, team = 0;
+
+    nThreads = omp_get_max_threads();
+    fds = (int *)malloc((size_t)nThreads * N_COUNTERS * sizeof(int));
+    if (!fds) {
+        nThreads = 0;
+        return;
+    }
+
+#pragma omp parallel num_threads(nThreads)
+    {
+        int t = omp_get_thread_num();
+        struct perf_event_attr attr;
+
+#pragma omp master
+        team = omp_get_num_threads();
+
+        for (int c = 0; c < N_COUNTERS; c++) {
+            int *fd = &fds[t * N_COUNTERS + c];
+
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = counters[c].type;
+            attr.config = counters[c].config;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+
+            *fd = !counters[c].intelOnly || intel ? syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0) : -1;
+        }
+    }
+
+    // The parallel region may have got fewer threads than asked for, the later regions will not have more.
+    nThreads = team;
+
+    for (int c = 0; c < N_COUNTERS; c++) {
+        counters[c].open = 1;
+        for (int t = 0; t < nThreads; t++) {
+            counters[c].open &= fds[t * N_COUNTERS + c] >= 0;
+        }
+
+        if (!counters[c].open) {
+            for (int t = 0; t < nThreads; t++) {
+                if (fds[t * N_COUNTERS + c] >= 0) {
+                    close(fds[t * N_COUNTERS + c]);
+                }
+                fds[t * N_COUNTERS + c] = -1;
+            }
+        }
+        nOpen += counters[c].open;
+    }
+
+    if (nOpen == 0) {
+        fprintf(stderr, "# perf_event_open indisponível (perf_event_paranoid?), contadores desativados.\n");
+    }
+}
+
+/**
+ * @brief Function to start a region. Regions may nest, but a region must not be started again before it stops.
+ *
+ * @param region Region name.
+ */
+void perfMarkerStart(const char *region) {
+    perfRegion *r = findRegion(region);
+
+    if (!r) {
+        return;
+    }
+
+    r->startTime = timestamp();
+    for (int t = 0; t < nThreads; t++) {
+        for (int c = 0; c < N_COUNTERS; c++) {
+            r->start[t * N_COUNTERS + c] = readCounter(t, c);
+        }
+    }
+}
+
+/**
+ * @brief Function to stop a region and add the counts since its start.
+ *
+ * When the kernel multiplexed a counter (it ran for less time than it was enabled) its delta is scaled by the ratio of
+ * the two times, the usual perf estimate.
+ *
+ * @param region Region name.
+ */
+void perfMarkerStop(const char *region) {
+    perfRegion *r = findRegion(region);
+
+    if (!r) {
+        return;
+    }
+
+    for (int t = 0; t < nThreads; t++) {
+        for (int c = 0; c < N_COUNTERS; c++) {
+            perfReading now = readCounter(t, c), *start = &r->start[t * N_COUNTERS + c];
+            uint64_t value = now.value - start->value, enabled = now.enabled - start->enabled, running = now.running - start->running;
+
+            if (running > 0 && running < enabled) {
+                r->count[c] += (double)value * enabled / running;
+                r->multiplexed[c] = 1;
+            } else {
+                r->count[c] += value;
+            }
+        }
+    }
+    r->time += timestamp() - r->startTime;
+    r->calls++;
+}
+
+/**
+ * @brief Function to print the counts of each region to stderr and close the counters.
+ */
+void perfMarkerClose(void) {
+    for (int r = 0; r < nRegions; r++) {
+        perfRegion *region = &regions[r];
+        double flops = 0.0;
+        int hasFlops = 0, flopsMultiplexed = 0;
+
+        fprintf(stderr, "# Região %s: %d chamadas, %lf ms\n", region->name, region->calls, region->time);
+
+        for (int c = 0; c < N_COUNTERS; c++) {
+            if (counters[c].flops) {
+                flops += counters[c].flops * region->count[c];
+                hasFlops |= counters[c].open;
+                flopsMultiplexed |= region->multiplexed[c];
+            } else if (counters[c].open) {
+                fprintf(stderr, "#   %s: %.0f%s\n", counters[c].name, region->count[c], region->multiplexed[c] ? " (multiplexado, escalado)" : "");
+            } else {
+                fprintf(stderr, "#   %s: n/d\n", counters[c].name);
+            }
+        }
+
+        if (counters[1].open && counters[2].open && region->count[1] > 0.0) {
+            fprintf(stderr, "#   IPC: %lf\n", region->count[2] / region->count[1]);
+        }
+
+        if (hasFlops) {
+            fprintf(stderr, "#   FP ops (DP): %.0f, %lf MFLOP/s%s\n", flops, region->time > 0.0 ? flops / (region->time * 1e3) : 0.0, flopsMultiplexed ? " (multiplexado, escalado)" : "");
+        } else {
+            fprintf(stderr, "#   FP ops (DP): n/d\n");
+        }
+
+        free(region->start);
+        region->start = NULL;
+    }
+
+    if (fds) {
+        for (int k = 0; k < nThreads * N_COUNTERS; k++) {
+            if (fds[k] >= 0) {
+                close(fds[k]);
+            }
+        }
+        free(fds);
+        fds = NULL;
+    }
+
+    for (int c = 0; c < N_COUNTERS; c++) {
+        counters[c].open = 0;
+    }
+}
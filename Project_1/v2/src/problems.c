@@ -0,0 +1,361 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "partialDifferential.h"
+#include "partialDifferential3d.h"
+#include "problems.h"
+
+#define M_PI 3.14159265358979323846
+#define SQR_PI M_PI *M_PI
+
+// ------------------------------------------------ STENCIL KERNELS ------------------------------------------------
+
+// The stencil coefficients depend on the mesh spacing, so what a problem fixes at compile time is the structure of its
+// stencil: without convection (cx = cy = 0) it is symmetric, id = sd and iid = ssd, and the opposite neighbours are
+// added before the product. The update multiplies by the inverse of the main diagonal and subtracts the term of the point
+// updated just before (x[k - 1]) last, so a product and a subtraction are on the dependency from one point to the next
+// instead of two subtractions and a division. The values differ from the ones of the generic kernels in the last bits.
+
+/**
+ * @brief Function to update the interior points in [begin, end) of a matrix-free lexicographic Gauss Seidel sweep.
+ *
+ * @param linSys Linear system struct.
+ * @param begin First point.
+ * @param end Last point + 1.
+ * @param omega Relaxation factor.
+ * @param symmetric Set when the stencil has id = sd and iid = ssd (a constant of each caller, folded when inlined).
+ */
+static inline void sweepStencilConstant(linearSystem *linSys, int begin, int end, real_t omega, const int symmetric) {
+    int nx = linSys->nx;
+    real_t *x = linSys->x;
+    const real_t *b = linSys->b;
+    stencil c = linSys->coef;
+    real_t inverse = 1.0 / c.md, rest, gs;
+
+    for (int k = begin; k < end; k++) {
+        if (symmetric) {
+            rest = (b[k] - (c.sd * x[k + 1])) - c.ssd * (x[k + nx] + x[k - nx]);
+            gs = (rest - (c.sd * x[k - 1])) * inverse;
+        } else {
+            rest = b[k] - (c.sd * x[k + 1]) - (c.ssd * x[k + nx]) - (c.iid * x[k - nx]);
+            gs = (rest - (c.id * x[k - 1])) * inverse;
+        }
+        x[k] = omega == 1.0 ? gs : x[k] + omega * (gs - x[k]);
+    }
+}
+
+/**
+ * @brief Function to sum the squared residuals of the interior points in [begin, end) of a matrix-free system.
+ *
+ * @param linSys Linear system struct.
+ * @param begin First point.
+ * @param end Last point + 1.
+ * @param symmetric Set when the stencil has id = sd and iid = ssd (a constant of each caller, folded when inlined).
+ * @return real_t
+ */
+static inline real_t residualSquaresStencilConstant(const linearSystem *linSys, int begin, int end, const int symmetric) {
+    int nx = linSys->nx;
+    const real_t *x = linSys->x, *b = linSys->b;
+    stencil c = linSys->coef;
+    real_t r, result = 0.0;
+
+    for (int k = begin; k < end; k++) {
+        if (symmetric) {
+            r = (b[k] - c.sd * (x[k + 1] + x[k - 1]) - c.ssd * (x[k + nx] + x[k - nx])) - c.md * x[k];
+        } else {
+            r = (b[k] - (c.sd * x[k + 1]) - (c.ssd * x[k + nx]) - (c.id * x[k - 1]) - (c.iid * x[k - nx])) - c.md * x[k];
+        }
+        result += r * r;
+    }
+
+    return result;
+}
+
+// ------------------------------------------------ SINH (PRODUCTION) ------------------------------------------------
+
+// -u_xx - u_yy + u_x + u_y + 4pi^2 u = 4pi^2 [sin(2pi x) sinh(pi y) + sin(2pi (pi - x)) sinh(pi (pi - y))] on [0, pi]^2.
+
+static real_t sinhSource(real_t x, real_t y) {
+    return 4 * SQR_PI * (sin(2 * M_PI * x) * sinh(M_PI * y) + sin(2 * M_PI * (M_PI - x)) * sinh(M_PI * (M_PI - y)));
+}
+
+static real_t sinhBottom(real_t x) {
+    return sin(2 * M_PI * (M_PI - x)) * sinh(SQR_PI);
+}
+
+static real_t sinhTop(real_t x) {
+    return sin(2 * M_PI * x) * sinh(SQR_PI);
+}
+
+static real_t zero(real_t t) {
+    (void)t;
+    return 0.0;
+}
+
+/**
+ * @brief Function to fill rows j0 to j0 + rows - 1 of the right-hand side of the sinh problem.
+ *
+ * @param linSys Linear system struct (nx, ny and coef are used).
+ * @param b Right-hand side of the rows (rows * nx).
+ * @param j0 First grid row.
+ * @param rows Number of rows.
+ */
+static void sinhRightHandSide(const linearSystem *linSys, real_t *b, int j0, int rows) {
+    real_t hx, hy, sqrHx, sqrHy;
+
+    gridSpacing(linSys, &hx, &hy);
+
+    sqrHx = hx * hx;
+    sqrHy = hy * hy;
+
+    // f(x, y) is separable: the sines only depend on the column and the hyperbolic sines only on the row. The tables turn
+    // the 4 * nx * ny transcendental calls into 2 * (nx + ny), and b is filled by a branch-free, vectorizable outer product.
+    int nx = linSys->nx, ny = linSys->ny;
+    real_t *sinX = (real_t *)malloc(nx * sizeof(real_t)), *sinMirrorX = (real_t *)malloc(nx * sizeof(real_t));
+    real_t *sinhY = (real_t *)malloc(rows * sizeof(real_t)), *sinhMirrorY = (real_t *)malloc(rows * sizeof(real_t));
+
+    for (int i = 0; i < nx; i++) {
+        sinX[i] = sin(2 * M_PI * ((i + 1) * hx));
+        sinMirrorX[i] = sin(2 * M_PI * (M_PI - (i + 1) * hx));
+    }
+
+    for (int j = 0; j < rows; j++) {
+        sinhY[j] = sinh(M_PI * ((j0 + j + 1) * hy));
+        sinhMirrorY[j] = sinh(M_PI * (M_PI - (j0 + j + 1) * hy));
+    }
+
+    real_t scale = (2 * sqrHx * sqrHy) * (4 * SQR_PI);
+
+#pragma omp parallel for schedule(static)
+    for (int j = 0; j < rows; j++) {
+        real_t *restrict row = b + j * nx;
+        real_t sinhJ = sinhY[j], sinhMirrorJ = sinhMirrorY[j];
+
+#pragma omp simd
+        for (int i = 0; i < nx; i++) {
+            row[i] = scale * ((sinX[i] * sinhJ) + (sinMirrorX[i] * sinhMirrorJ));
+        }
+    }
+
+    // Bottom and upper edges of the mesh; the left and right edges are zero.
+    real_t sinhEdge = sinh(SQR_PI);
+
+    if (j0 == 0) {
+        for (int i = 0; i < nx; i++) {
+            b[i] -= (sinMirrorX[i] * sinhEdge) * linSys->coef.iid;
+        }
+    }
+
+    if (j0 + rows == ny) {
+        real_t *upper = b + (rows - 1) * nx;
+
+        for (int i = 0; i < nx; i++) {
+            upper[i] -= (sinX[i] * sinhEdge) * linSys->coef.ssd;
+        }
+    }
+
+    free(sinX);
+    free(sinMirrorX);
+    free(sinhY);
+    free(sinhMirrorY);
+}
+
+/**
+ * @brief Function to update the interior points in [begin, end) for the sinh problem (convection in x and y).
+ *
+ * @param linSys Linear system struct.
+ * @param begin First point.
+ * @param end Last point + 1.
+ * @param omega Relaxation factor.
+ */
+static void sinhSweepStencil(linearSystem *linSys, int begin, int end, real_t omega) {
+    sweepStencilConstant(linSys, begin, end, omega, 0);
+}
+
+/**
+ * @brief Function to sum the squared residuals of the interior points in [begin, end) for the sinh problem.
+ *
+ * @param linSys Linear system struct.
+ * @param begin First point.
+ * @param end Last point + 1.
+ * @return real_t
+ */
+static real_t sinhResidualSquaresStencil(const linearSystem *linSys, int begin, int end) {
+    return residualSquaresStencilConstant(linSys, begin, end, 0);
+}
+
+// ------------------------------------------------ POISSON ------------------------------------------------
+
+// -u_xx - u_yy = 2pi^2 sin(pi x) sin(pi y) on [0, 1]^2 with u = 0 on the edges. The solution is sin(pi x) sin(pi y).
+
+static real_t poissonSource(real_t x, real_t y) {
+    return 2 * SQR_PI * sin(M_PI * x) * sin(M_PI * y);
+}
+
+/**
+ * @brief Function to fill rows j0 to j0 + rows - 1 of the right-hand side of the Poisson problem, as the outer product of
+ * one table of sines per direction (the edges are zero).
+ *
+ * @param linSys Linear system struct (nx and ny are used).
+ * @param b Right-hand side of the rows (rows * nx).
+ * @param j0 First grid row.
+ * @param rows Number of rows.
+ */
+static void poissonRightHandSide(const linearSystem *linSys, real_t *b, int j0, int rows) {
+    int nx = linSys->nx;
+    real_t hx, hy;
+
+    gridSpacing(linSys, &hx, &hy);
+
+    real_t *sinX = (real_t *)malloc(nx * sizeof(real_t)), scale = (2 * (hx * hx) * (hy * hy)) * (2 * SQR_PI);
+
+    for (int i = 0; i < nx; i++) {
+        sinX[i] = sin(M_PI * ((i + 1) * hx));
+    }
+
+#pragma omp parallel for schedule(static)
+    for (int j = 0; j < rows; j++) {
+        real_t *restrict row = b + j * nx;
+        real_t sinJ = scale * sin(M_PI * ((j0 + j + 1) * hy));
+
+#pragma omp simd
+        for (int i = 0; i < nx; i++) {
+            row[i] = sinJ * sinX[i];
+        }
+    }
+
+    free(sinX);
+}
+
+/**
+ * @brief Function to update the interior points in [begin, end) for the Poisson problem (symmetric stencil).
+ *
+ * @param linSys Linear system struct.
+ * @param begin First point.
+ * @param end Last point + 1.
+ * @param omega Relaxation factor.
+ */
+static void poissonSweepStencil(linearSystem *linSys, int begin, int end, real_t omega) {
+    sweepStencilConstant(linSys, begin, end, omega, 1);
+}
+
+/**
+ * @brief Function to sum the squared residuals of the interior points in [begin, end) for the Poisson problem.
+ *
+ * @param linSys Linear system struct.
+ * @param begin First point.
+ * @param end Last point + 1.
+ * @return real_t
+ */
+static real_t poissonResidualSquaresStencil(const linearSystem *linSys, int begin, int end) {
+    return residualSquaresStencilConstant(linSys, begin, end, 1);
+}
+
+// ------------------------------------------------ LAPLACE ------------------------------------------------
+
+// -u_xx - u_yy = 0 on [0, 1]^2 with u = x^2 - y^2 on the edges, which is also the solution (and the one of the discrete
+// system, the five point stencil is exact for quadratics). It has no specialized assembly or kernels.
+
+static real_t laplaceSource(real_t x, real_t y) {
+    (void)x;
+    (void)y;
+    return 0.0;
+}
+
+static real_t laplaceBottom(real_t x) {
+    return x * x;
+}
+
+static real_t laplaceTop(real_t x) {
+    return x * x - 1;
+}
+
+static real_t laplaceLeft(real_t y) {
+    return -y * y;
+}
+
+static real_t laplaceRight(real_t y) {
+    return 1 - y * y;
+}
+
+// Built in problems, terminated by an entry without name. The first one is DEFAULT_PROBLEM.
+const problem problems[] = {
+    {"sinh", 0.0, M_PI, 0.0, M_PI, 1.0, 1.0, 1.0, 1.0, 4 * SQR_PI, sinhSource, sinhBottom, sinhTop, zero, zero, sinhRightHandSide, sinhSweepStencil, sinhResidualSquaresStencil},
+    {"poisson", 0.0, 1.0, 0.0, 1.0, 1.0, 1.0, 0.0, 0.0, 0.0, poissonSource, zero, zero, zero, zero, poissonRightHandSide, poissonSweepStencil, poissonResidualSquaresStencil},
+    {"laplace", 0.0, 1.0, 0.0, 1.0, 1.0, 1.0, 0.0, 0.0, 0.0, laplaceSource, laplaceBottom, laplaceTop, laplaceLeft, laplaceRight, NULL, NULL, NULL},
+    {NULL},
+};
+
+// ------------------------------------------------ 3D ------------------------------------------------
+
+// -u_xx - u_yy - u_zz = 3pi^2 sin(pi x) sin(pi y) sin(pi z) on [0, 1]^3 with u = 0 on the faces. The solution is
+// sin(pi x) sin(pi y) sin(pi z).
+
+static real_t poisson3dSource(real_t x, real_t y, real_t z) {
+    return 3 * SQR_PI * sin(M_PI * x) * sin(M_PI * y) * sin(M_PI * z);
+}
+
+static real_t zero3d(real_t x, real_t y, real_t z) {
+    (void)x;
+    (void)y;
+    (void)z;
+    return 0.0;
+}
+
+// -u_xx - u_yy - u_zz = 0 on [0, 1]^3 with u = x^2 + y^2 - 2z^2 on the faces, which is also the discrete solution.
+
+static real_t laplace3dBoundary(real_t x, real_t y, real_t z) {
+    return x * x + y * y - 2 * z * z;
+}
+
+// -u_xx - u_yy - u_zz + 10 (u_x + u_y + u_z) = 1 on [0, 1]^3 with u = 0 on the faces: a boundary layer forms next to
+// the faces x = 1, y = 1 and z = 1.
+
+static real_t one3d(real_t x, real_t y, real_t z) {
+    (void)x;
+    (void)y;
+    (void)z;
+    return 1.0;
+}
+
+// Built in 3D problems, terminated by an entry without name. The first one is DEFAULT_PROBLEM_3D.
+const problem3d problems3d[] = {
+    {"poisson", 0.0, 1.0, 0.0, 1.0, 0.0, 1.0, 1.0, 1.0, 1.0, 0.0, 0.0, 0.0, 0.0, poisson3dSource, zero3d},
+    {"laplace", 0.0, 1.0, 0.0, 1.0, 0.0, 1.0, 1.0, 1.0, 1.0, 0.0, 0.0, 0.0, 0.0, zero3d, laplace3dBoundary},
+    {"conveccao", 0.0, 1.0, 0.0, 1.0, 0.0, 1.0, 1.0, 1.0, 1.0, 10.0, 10.0, 10.0, 0.0, one3d, zero3d},
+    {NULL},
+};
+
+/**
+ * @brief Function to find a built in problem by name.
+ *
+ * @param name Problem name.
+ * @return const problem* NULL if there is no such problem.
+ */
+const problem *findProblem(const char *name) {
+    for (const problem *p = problems; p->name; p++) {
+        if (strcmp(p->name, name) == 0) {
+            return p;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Function to find a built in 3D problem by name.
+ *
+ * @param name Problem name.
+ * @return const problem3d* NULL if there is no such problem.
+ */
+const problem3d *findProblem3d(const char *name) {
+    for (const problem3d *p = problems3d; p->name; p++) {
+        if (strcmp(p->name, name) == 0) {
+            return p;
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,273 @@
+#include <immintrin.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "roofline.h"
+#include "simdKernels.h"
+#include "utils.h"
+
+#define STREAM_ELEMENTS (1 << 24)  // Elements of each STREAM array (128MB, well above the last level cache).
+#define STREAM_REPEATS 5           // Triad runs, the best one is kept.
+#define FMA_ITERATIONS (1 << 22)   // Iterations of the FMA probe per thread.
+#define FMA_REPEATS 3              // FMA runs, the best one is kept.
+#define FMA_CHAINS 16              // Independent accumulators, enough to cover latency times FMA ports.
+
+/**
+ * @brief Function to measure the memory bandwidth with the STREAM triad a = b + s * c, split across OpenMP threads.
+ *
+ * The arrays are initialized by the threads that use them (first touch). As in STREAM, 24 bytes are counted per element.
+ *
+ * @return double GB/s.
+ */
+static double streamTriad(void) {
+    double *a, *b, *c, best = 0.0, start, time, rate;
+    size_t bytes = STREAM_ELEMENTS * sizeof(double);
+
+    if (posix_memalign((void **)&a, 64, bytes) || posix_memalign((void **)&b, 64, bytes) || posix_memalign((void **)&c, 64, bytes)) {
+        return 0.0;
+    }
+
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < STREAM_ELEMENTS; i++) {
+        a[i] = 0.0;
+        b[i] = 1.0;
+        c[i] = 2.0;
+    }
+
+    for (int r = 0; r < STREAM_REPEATS; r++) {
+        start = timestamp();
+
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < STREAM_ELEMENTS; i++) {
+            a[i] = b[i] + 3.0 * c[i];
+        }
+
+        time = timestamp() - start;
+        rate = 3.0 * bytes / (time * 1e6);
+        best = rate > best ? rate : best;
+    }
+
+    free(a);
+    free(b);
+    free(c);
+
+    return best;
+}
+
+/**
+ * @brief Function to run FMA_ITERATIONS multiply-add steps on FMA_CHAINS scalar accumulators.
+ *
+ * Vectorization is disabled for this function, otherwise the chains are packed in SSE2 registers. The scalar kernels
+ * are built without FMA and with -ffp-contract=off, so each step is a multiplication and an addition, as in them.
+ *
+ * @param seed Start value (not known at compile time).
+ * @return double Sum of the accumulators, to keep the work.
+ */
+__attribute__((optimize("no-tree-vectorize"))) static double fmaChainsScalar(double seed) {
+    double acc[FMA_CHAINS], sum = 0.0;
+
+    for (int k = 0; k < FMA_CHAINS; k++) {
+        acc[k] = seed + k;
+    }
+
+    for (int it = 0; it < FMA_ITERATIONS; it++) {
+        for (int k = 0; k < FMA_CHAINS; k++) {
+            acc[k] = acc[k] * 0.999999 + 1e-6;
+        }
+    }
+
+    for (int k = 0; k < FMA_CHAINS; k++) {
+        sum += acc[k];
+    }
+
+    return sum;
+}
+
+/**
+ * @brief Function to run FMA_ITERATIONS multiply-add steps on FMA_CHAINS scalar float accumulators, as
+ * fmaChainsScalar().
+ *
+ * @param seed Start value (not known at compile time).
+ * @return double Sum of the accumulators, to keep the work.
+ */
+__attribute__((optimize("no-tree-vectorize"))) static double fmaChainsScalarFloat(double seed) {
+    float acc[FMA_CHAINS], sum = 0.0f;
+
+    for (int k = 0; k < FMA_CHAINS; k++) {
+        acc[k] = (float)seed + k;
+    }
+
+    for (int it = 0; it < FMA_ITERATIONS; it++) {
+        for (int k = 0; k < FMA_CHAINS; k++) {
+            acc[k] = acc[k] * 0.999999f + 1e-6f;
+        }
+    }
+
+    for (int k = 0; k < FMA_CHAINS; k++) {
+        sum += acc[k];
+    }
+
+    return sum;
+}
+
+__attribute__((target("avx2,fma"))) static double fmaChainsAvx2(double seed) {
+    __m256d acc[FMA_CHAINS], m = _mm256_set1_pd(0.999999), a = _mm256_set1_pd(1e-6), sum = _mm256_setzero_pd();
+    double lanes[4];
+
+    for (int k = 0; k < FMA_CHAINS; k++) {
+        acc[k] = _mm256_set1_pd(seed + k);
+    }
+
+    for (int it = 0; it < FMA_ITERATIONS; it++) {
+        for (int k = 0; k < FMA_CHAINS; k++) {
+            acc[k] = _mm256_fmadd_pd(acc[k], m, a);
+        }
+    }
+
+    for (int k = 0; k < FMA_CHAINS; k++) {
+        sum = _mm256_add_pd(sum, acc[k]);
+    }
+    _mm256_storeu_pd(lanes, sum);
+
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+__attribute__((target("avx2,fma"))) static double fmaChainsAvx2Float(double seed) {
+    __m256 acc[FMA_CHAINS], m = _mm256_set1_ps(0.999999f), a = _mm256_set1_ps(1e-6f), sum = _mm256_setzero_ps();
+    float lanes[8];
+    double result = 0.0;
+
+    for (int k = 0; k < FMA_CHAINS; k++) {
+        acc[k] = _mm256_set1_ps((float)seed + k);
+    }
+
+    for (int it = 0; it < FMA_ITERATIONS; it++) {
+        for (int k = 0; k < FMA_CHAINS; k++) {
+            acc[k] = _mm256_fmadd_ps(acc[k], m, a);
+        }
+    }
+
+    for (int k = 0; k < FMA_CHAINS; k++) {
+        sum = _mm256_add_ps(sum, acc[k]);
+    }
+    _mm256_storeu_ps(lanes, sum);
+
+    for (int l = 0; l < 8; l++) {
+        result += lanes[l];
+    }
+
+    return result;
+}
+
+__attribute__((target("avx512f"))) static double fmaChainsAvx512(double seed) {
+    __m512d acc[FMA_CHAINS], m = _mm512_set1_pd(0.999999), a = _mm512_set1_pd(1e-6), sum = _mm512_setzero_pd();
+
+    for (int k = 0; k < FMA_CHAINS; k++) {
+        acc[k] = _mm512_set1_pd(seed + k);
+    }
+
+    for (int it = 0; it < FMA_ITERATIONS; it++) {
+        for (int k = 0; k < FMA_CHAINS; k++) {
+            acc[k] = _mm512_fmadd_pd(acc[k], m, a);
+        }
+    }
+
+    for (int k = 0; k < FMA_CHAINS; k++) {
+        sum = _mm512_add_pd(sum, acc[k]);
+    }
+
+    return _mm512_reduce_add_pd(sum);
+}
+
+__attribute__((target("avx512f"))) static double fmaChainsAvx512Float(double seed) {
+    __m512 acc[FMA_CHAINS], m = _mm512_set1_ps(0.999999f), a = _mm512_set1_ps(1e-6f), sum = _mm512_setzero_ps();
+
+    for (int k = 0; k < FMA_CHAINS; k++) {
+        acc[k] = _mm512_set1_ps((float)seed + k);
+    }
+
+    for (int it = 0; it < FMA_ITERATIONS; it++) {
+        for (int k = 0; k < FMA_CHAINS; k++) {
+            acc[k] = _mm512_fmadd_ps(acc[k], m, a);
+        }
+    }
+
+    for (int k = 0; k < FMA_CHAINS; k++) {
+        sum = _mm512_add_ps(sum, acc[k]);
+    }
+
+    return _mm512_reduce_add_ps(sum);
+}
+
+/**
+ * @brief Function to measure the multiply-add throughput, every OpenMP thread running independent chains with the
+ * instruction set selected for the SIMD kernels (kernels.name): FMA for the vector ones, a multiplication and an
+ * addition for the scalar one. Each step counts as 2 flops per lane.
+ *
+ * @param singlePrecision Measure the float chains, which have twice the lanes of the double ones.
+ * @return double GFLOP/s.
+ */
+static double fmaPeak(int singlePrecision) {
+    int lanes = strcmp(kernels.name, "avx512") == 0 ? 8 : strcmp(kernels.name, "avx2") == 0 ? 4 : 1;
+    double (*chains)(double);
+    double best = 0.0, start, time, rate, sink = 0.0;
+    int nThreads = 1;
+
+    if (singlePrecision) {
+        chains = lanes == 8 ? fmaChainsAvx512Float : lanes == 4 ? fmaChainsAvx2Float : fmaChainsScalarFloat;
+        lanes *= lanes > 1 ? 2 : 1;
+    } else {
+        chains = lanes == 8 ? fmaChainsAvx512 : lanes == 4 ? fmaChainsAvx2 : fmaChainsScalar;
+    }
+
+    for (int r = 0; r < FMA_REPEATS; r++) {
+        start = timestamp();
+
+#pragma omp parallel reduction(+ : sink)
+        {
+#pragma omp single
+            nThreads = omp_get_num_threads();
+
+            sink += chains(sink + 1.0);
+        }
+
+        time = timestamp() - start;
+        rate = 2.0 * lanes * FMA_CHAINS * (double)FMA_ITERATIONS * nThreads / (time * 1e6);
+        best = rate > best ? rate : best;
+    }
+
+    // The result is never zero, this only keeps the compiler from dropping the chains.
+    return sink != 0.0 ? best : 0.0;
+}
+
+/**
+ * @brief Function to measure the bandwidth and compute roofs of the machine.
+ *
+ * @return machinePeaks
+ */
+machinePeaks measureMachinePeaks(void) {
+    machinePeaks peaks;
+
+    peaks.bandwidth = streamTriad();
+    peaks.flops = fmaPeak(0);
+    peaks.floatFlops = fmaPeak(1);
+    peaks.probe = strcmp(kernels.name, "avx512") == 0 ? "FMA avx512" : strcmp(kernels.name, "avx2") == 0 ? "FMA avx2" : "mul+add escalar";
+
+    return peaks;
+}
+
+/**
+ * @brief Function to return the attainable performance of a kernel with the given arithmetic intensity.
+ *
+ * @param peaks Roofs of the machine.
+ * @param intensity Flops per byte moved from memory.
+ * @param singlePrecision The kernel computes in float (float roof).
+ * @return double GFLOP/s.
+ */
+double attainableFlops(const machinePeaks *peaks, double intensity, int singlePrecision) {
+    double memoryRoof = intensity * peaks->bandwidth, computeRoof = singlePrecision ? peaks->floatFlops : peaks->flops;
+
+    return memoryRoof < computeRoof ? memoryRoof : computeRoof;
+}
@@ -0,0 +1,344 @@
+#include <immintrin.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simdKernels.h"
+
+// ------------------------------------------------ SCALAR ------------------------------------------------
+
+/**
+ * @brief Function to add the squared residuals of the points in [begin, end) to result, reading the five diagonals.
+ *
+ * @param linSys Linear system struct.
+ * @param begin First point.
+ * @param end Last point + 1.
+ * @param result Sum of the points before begin.
+ * @return real_t
+ */
+static inline real_t addResidualSquaresDiagonals(const linearSystem *linSys, int begin, int end, real_t result) {
+    int nx = linSys->nx;
+    const real_t *x = linSys->x, *b = linSys->b;
+    const real_t *ssd = linSys->ssd, *sd = linSys->sd, *md = linSys->md, *id = linSys->id, *iid = linSys->iid;
+    real_t r;
+
+    for (int k = begin; k < end; k++) {
+        r = (b[k] - (sd[k] * x[k + 1]) - (ssd[k] * x[k + nx]) - (id[k] * x[k - 1]) - (iid[k] * x[k - nx])) - md[k] * x[k];
+        result += r * r;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Function to add the squared residuals of the points in [begin, end) to result, with the stencil coefficients.
+ *
+ * @param linSys Linear system struct.
+ * @param begin First point.
+ * @param end Last point + 1.
+ * @param result Sum of the points before begin.
+ * @return real_t
+ */
+static inline real_t addResidualSquaresStencil(const linearSystem *linSys, int begin, int end, real_t result) {
+    int nx = linSys->nx;
+    const real_t *x = linSys->x, *b = linSys->b;
+    stencil c = linSys->coef;
+    real_t r;
+
+    for (int k = begin; k < end; k++) {
+        r = (b[k] - (c.sd * x[k + 1]) - (c.ssd * x[k + nx]) - (c.id * x[k - 1]) - (c.iid * x[k - nx])) - c.md * x[k];
+        result += r * r;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Function to sum the squared residuals of the points in [begin, end), reading the five diagonals.
+ *
+ * @param linSys Linear system struct.
+ * @param begin First point.
+ * @param end Last point + 1.
+ * @return real_t
+ */
+static real_t residualSquaresDiagonalsScalar(const linearSystem *linSys, int begin, int end) {
+    return addResidualSquaresDiagonals(linSys, begin, end, 0.0);
+}
+
+/**
+ * @brief Function to sum the squared residuals of the points in [begin, end), with the stencil coefficients.
+ *
+ * @param linSys Linear system struct.
+ * @param begin First point.
+ * @param end Last point + 1.
+ * @return real_t
+ */
+static real_t residualSquaresStencilScalar(const linearSystem *linSys, int begin, int end) {
+    return addResidualSquaresStencil(linSys, begin, end, 0.0);
+}
+
+/**
+ * @brief Function to compute y = A v for the points in [begin, end), reading the five diagonals.
+ *
+ * @param linSys Linear system struct.
+ * @param v Vector.
+ * @param y Result.
+ * @param begin First point.
+ * @param end Last point + 1.
+ */
+static void stencilProductDiagonalsScalar(const linearSystem *linSys, const real_t *v, real_t *y, int begin, int end) {
+    int nx = linSys->nx;
+
+    for (int k = begin; k < end; k++) {
+        y[k] = linSys->md[k] * v[k] + linSys->sd[k] * v[k + 1] + linSys->id[k] * v[k - 1] + linSys->ssd[k] * v[k + nx] + linSys->iid[k] * v[k - nx];
+    }
+}
+
+/**
+ * @brief Function to compute y = A v for the points in [begin, end), with the stencil coefficients.
+ *
+ * @param linSys Linear system struct.
+ * @param v Vector.
+ * @param y Result.
+ * @param begin First point.
+ * @param end Last point + 1.
+ */
+static void stencilProductStencilScalar(const linearSystem *linSys, const real_t *v, real_t *y, int begin, int end) {
+    int nx = linSys->nx;
+    stencil c = linSys->coef;
+
+    for (int k = begin; k < end; k++) {
+        y[k] = c.md * v[k] + c.sd * v[k + 1] + c.id * v[k - 1] + c.ssd * v[k + nx] + c.iid * v[k - nx];
+    }
+}
+
+// ------------------------------------------------ AVX2 ------------------------------------------------
+
+// Same operations as the scalar versions, 4 lanes. The residuals are rounded as in the scalar versions (a product, then
+// a subtraction) and their squares are added to the sum one lane at a time, so the norms are bitwise the scalar ones and
+// do not depend on the CPU. The products by A use fused multiply-add. Compiled for AVX2 regardless of CFLAGS.
+
+/**
+ * @brief AVX2 version of residualSquaresDiagonalsScalar().
+ */
+__attribute__((target("avx2"))) static real_t residualSquaresDiagonalsAvx2(const linearSystem *linSys, int begin, int end) {
+    int nx = linSys->nx, k = begin;
+    const real_t *x = linSys->x, *b = linSys->b;
+    const real_t *ssd = linSys->ssd, *sd = linSys->sd, *md = linSys->md, *id = linSys->id, *iid = linSys->iid;
+    __m256d r;
+    real_t lanes[4], result = 0.0;
+
+    for (; k + 4 <= end; k += 4) {
+        r = _mm256_loadu_pd(b + k);
+        r = _mm256_sub_pd(r, _mm256_mul_pd(_mm256_loadu_pd(sd + k), _mm256_loadu_pd(x + k + 1)));
+        r = _mm256_sub_pd(r, _mm256_mul_pd(_mm256_loadu_pd(ssd + k), _mm256_loadu_pd(x + k + nx)));
+        r = _mm256_sub_pd(r, _mm256_mul_pd(_mm256_loadu_pd(id + k), _mm256_loadu_pd(x + k - 1)));
+        r = _mm256_sub_pd(r, _mm256_mul_pd(_mm256_loadu_pd(iid + k), _mm256_loadu_pd(x + k - nx)));
+        r = _mm256_sub_pd(r, _mm256_mul_pd(_mm256_loadu_pd(md + k), _mm256_loadu_pd(x + k)));
+        _mm256_storeu_pd(lanes, _mm256_mul_pd(r, r));
+
+        for (int l = 0; l < 4; l++) {
+            result += lanes[l];
+        }
+    }
+
+    return addResidualSquaresDiagonals(linSys, k, end, result);
+}
+
+/**
+ * @brief AVX2 version of residualSquaresStencilScalar().
+ */
+__attribute__((target("avx2"))) static real_t residualSquaresStencilAvx2(const linearSystem *linSys, int begin, int end) {
+    int nx = linSys->nx, k = begin;
+    const real_t *x = linSys->x, *b = linSys->b;
+    __m256d ssd = _mm256_set1_pd(linSys->coef.ssd), sd = _mm256_set1_pd(linSys->coef.sd), md = _mm256_set1_pd(linSys->coef.md);
+    __m256d id = _mm256_set1_pd(linSys->coef.id), iid = _mm256_set1_pd(linSys->coef.iid);
+    __m256d r;
+    real_t lanes[4], result = 0.0;
+
+    for (; k + 4 <= end; k += 4) {
+        r = _mm256_loadu_pd(b + k);
+        r = _mm256_sub_pd(r, _mm256_mul_pd(sd, _mm256_loadu_pd(x + k + 1)));
+        r = _mm256_sub_pd(r, _mm256_mul_pd(ssd, _mm256_loadu_pd(x + k + nx)));
+        r = _mm256_sub_pd(r, _mm256_mul_pd(id, _mm256_loadu_pd(x + k - 1)));
+        r = _mm256_sub_pd(r, _mm256_mul_pd(iid, _mm256_loadu_pd(x + k - nx)));
+        r = _mm256_sub_pd(r, _mm256_mul_pd(md, _mm256_loadu_pd(x + k)));
+        _mm256_storeu_pd(lanes, _mm256_mul_pd(r, r));
+
+        for (int l = 0; l < 4; l++) {
+            result += lanes[l];
+        }
+    }
+
+    return addResidualSquaresStencil(linSys, k, end, result);
+}
+
+/**
+ * @brief AVX2 version of stencilProductDiagonalsScalar().
+ */
+__attribute__((target("avx2,fma"))) static void stencilProductDiagonalsAvx2(const linearSystem *linSys, const real_t *v, real_t *y, int begin, int end) {
+    int nx = linSys->nx, k = begin;
+    __m256d acc;
+
+    for (; k + 4 <= end; k += 4) {
+        acc = _mm256_mul_pd(_mm256_loadu_pd(linSys->md + k), _mm256_loadu_pd(v + k));
+        acc = _mm256_fmadd_pd(_mm256_loadu_pd(linSys->sd + k), _mm256_loadu_pd(v + k + 1), acc);
+        acc = _mm256_fmadd_pd(_mm256_loadu_pd(linSys->id + k), _mm256_loadu_pd(v + k - 1), acc);
+        acc = _mm256_fmadd_pd(_mm256_loadu_pd(linSys->ssd + k), _mm256_loadu_pd(v + k + nx), acc);
+        acc = _mm256_fmadd_pd(_mm256_loadu_pd(linSys->iid + k), _mm256_loadu_pd(v + k - nx), acc);
+        _mm256_storeu_pd(y + k, acc);
+    }
+
+    stencilProductDiagonalsScalar(linSys, v, y, k, end);
+}
+
+/**
+ * @brief AVX2 version of stencilProductStencilScalar().
+ */
+__attribute__((target("avx2,fma"))) static void stencilProductStencilAvx2(const linearSystem *linSys, const real_t *v, real_t *y, int begin, int end) {
+    int nx = linSys->nx, k = begin;
+    __m256d ssd = _mm256_set1_pd(linSys->coef.ssd), sd = _mm256_set1_pd(linSys->coef.sd), md = _mm256_set1_pd(linSys->coef.md);
+    __m256d id = _mm256_set1_pd(linSys->coef.id), iid = _mm256_set1_pd(linSys->coef.iid);
+    __m256d acc;
+
+    for (; k + 4 <= end; k += 4) {
+        acc = _mm256_mul_pd(md, _mm256_loadu_pd(v + k));
+        acc = _mm256_fmadd_pd(sd, _mm256_loadu_pd(v + k + 1), acc);
+        acc = _mm256_fmadd_pd(id, _mm256_loadu_pd(v + k - 1), acc);
+        acc = _mm256_fmadd_pd(ssd, _mm256_loadu_pd(v + k + nx), acc);
+        acc = _mm256_fmadd_pd(iid, _mm256_loadu_pd(v + k - nx), acc);
+        _mm256_storeu_pd(y + k, acc);
+    }
+
+    stencilProductStencilScalar(linSys, v, y, k, end);
+}
+
+// ------------------------------------------------ AVX-512 ------------------------------------------------
+
+// Same operations as the scalar versions, 8 lanes, with the residuals and the norms rounded as in the AVX2 versions.
+// Compiled for AVX-512 regardless of CFLAGS.
+
+/**
+ * @brief AVX-512 version of residualSquaresDiagonalsScalar().
+ */
+__attribute__((target("avx512f"))) static real_t residualSquaresDiagonalsAvx512(const linearSystem *linSys, int begin, int end) {
+    int nx = linSys->nx, k = begin;
+    const real_t *x = linSys->x, *b = linSys->b;
+    const real_t *ssd = linSys->ssd, *sd = linSys->sd, *md = linSys->md, *id = linSys->id, *iid = linSys->iid;
+    __m512d r;
+    real_t lanes[8], result = 0.0;
+
+    for (; k + 8 <= end; k += 8) {
+        r = _mm512_loadu_pd(b + k);
+        r = _mm512_sub_pd(r, _mm512_mul_pd(_mm512_loadu_pd(sd + k), _mm512_loadu_pd(x + k + 1)));
+        r = _mm512_sub_pd(r, _mm512_mul_pd(_mm512_loadu_pd(ssd + k), _mm512_loadu_pd(x + k + nx)));
+        r = _mm512_sub_pd(r, _mm512_mul_pd(_mm512_loadu_pd(id + k), _mm512_loadu_pd(x + k - 1)));
+        r = _mm512_sub_pd(r, _mm512_mul_pd(_mm512_loadu_pd(iid + k), _mm512_loadu_pd(x + k - nx)));
+        r = _mm512_sub_pd(r, _mm512_mul_pd(_mm512_loadu_pd(md + k), _mm512_loadu_pd(x + k)));
+        _mm512_storeu_pd(lanes, _mm512_mul_pd(r, r));
+
+        for (int l = 0; l < 8; l++) {
+            result += lanes[l];
+        }
+    }
+
+    return addResidualSquaresDiagonals(linSys, k, end, result);
+}
+
+/**
+ * @brief AVX-512 version of residualSquaresStencilScalar().
+ */
+__attribute__((target("avx512f"))) static real_t residualSquaresStencilAvx512(const linearSystem *linSys, int begin, int end) {
+    int nx = linSys->nx, k = begin;
+    const real_t *x = linSys->x, *b = linSys->b;
+    __m512d ssd = _mm512_set1_pd(linSys->coef.ssd), sd = _mm512_set1_pd(linSys->coef.sd), md = _mm512_set1_pd(linSys->coef.md);
+    __m512d id = _mm512_set1_pd(linSys->coef.id), iid = _mm512_set1_pd(linSys->coef.iid);
+    __m512d r;
+    real_t lanes[8], result = 0.0;
+
+    for (; k + 8 <= end; k += 8) {
+        r = _mm512_loadu_pd(b + k);
+        r = _mm512_sub_pd(r, _mm512_mul_pd(sd, _mm512_loadu_pd(x + k + 1)));
+        r = _mm512_sub_pd(r, _mm512_mul_pd(ssd, _mm512_loadu_pd(x + k + nx)));
+        r = _mm512_sub_pd(r, _mm512_mul_pd(id, _mm512_loadu_pd(x + k - 1)));
+        r = _mm512_sub_pd(r, _mm512_mul_pd(iid, _mm512_loadu_pd(x + k - nx)));
+        r = _mm512_sub_pd(r, _mm512_mul_pd(md, _mm512_loadu_pd(x + k)));
+        _mm512_storeu_pd(lanes, _mm512_mul_pd(r, r));
+
+        for (int l = 0; l < 8; l++) {
+            result += lanes[l];
+        }
+    }
+
+    return addResidualSquaresStencil(linSys, k, end, result);
+}
+
+/**
+ * @brief AVX-512 version of stencilProductDiagonalsScalar().
+ */
+__attribute__((target("avx512f"))) static void stencilProductDiagonalsAvx512(const linearSystem *linSys, const real_t *v, real_t *y, int begin, int end) {
+    int nx = linSys->nx, k = begin;
+    __m512d acc;
+
+    for (; k + 8 <= end; k += 8) {
+        acc = _mm512_mul_pd(_mm512_loadu_pd(linSys->md + k), _mm512_loadu_pd(v + k));
+        acc = _mm512_fmadd_pd(_mm512_loadu_pd(linSys->sd + k), _mm512_loadu_pd(v + k + 1), acc);
+        acc = _mm512_fmadd_pd(_mm512_loadu_pd(linSys->id + k), _mm512_loadu_pd(v + k - 1), acc);
+        acc = _mm512_fmadd_pd(_mm512_loadu_pd(linSys->ssd + k), _mm512_loadu_pd(v + k + nx), acc);
+        acc = _mm512_fmadd_pd(_mm512_loadu_pd(linSys->iid + k), _mm512_loadu_pd(v + k - nx), acc);
+        _mm512_storeu_pd(y + k, acc);
+    }
+
+    stencilProductDiagonalsScalar(linSys, v, y, k, end);
+}
+
+/**
+ * @brief AVX-512 version of stencilProductStencilScalar().
+ */
+__attribute__((target("avx512f"))) static void stencilProductStencilAvx512(const linearSystem *linSys, const real_t *v, real_t *y, int begin, int end) {
+    int nx = linSys->nx, k = begin;
+    __m512d ssd = _mm512_set1_pd(linSys->coef.ssd), sd = _mm512_set1_pd(linSys->coef.sd), md = _mm512_set1_pd(linSys->coef.md);
+    __m512d id = _mm512_set1_pd(linSys->coef.id), iid = _mm512_set1_pd(linSys->coef.iid);
+    __m512d acc;
+
+    for (; k + 8 <= end; k += 8) {
+        acc = _mm512_mul_pd(md, _mm512_loadu_pd(v + k));
+        acc = _mm512_fmadd_pd(sd, _mm512_loadu_pd(v + k + 1), acc);
+        acc = _mm512_fmadd_pd(id, _mm512_loadu_pd(v + k - 1), acc);
+        acc = _mm512_fmadd_pd(ssd, _mm512_loadu_pd(v + k + nx), acc);
+        acc = _mm512_fmadd_pd(iid, _mm512_loadu_pd(v + k - nx), acc);
+        _mm512_storeu_pd(y + k, acc);
+    }
+
+    stencilProductStencilScalar(linSys, v, y, k, end);
+}
+
+// ------------------------------------------------ DISPATCH ------------------------------------------------
+
+static const simdKernels scalarKernels = {"scalar", residualSquaresDiagonalsScalar, residualSquaresStencilScalar, stencilProductDiagonalsScalar, stencilProductStencilScalar};
+static const simdKernels avx2Kernels = {"avx2", residualSquaresDiagonalsAvx2, residualSquaresStencilAvx2, stencilProductDiagonalsAvx2, stencilProductStencilAvx2};
+static const simdKernels avx512Kernels = {"avx512", residualSquaresDiagonalsAvx512, residualSquaresStencilAvx512, stencilProductDiagonalsAvx512, stencilProductStencilAvx512};
+
+// Kernels in use, scalar until initSimdKernels() is called.
+simdKernels kernels = {"scalar", residualSquaresDiagonalsScalar, residualSquaresStencilScalar, stencilProductDiagonalsScalar, stencilProductStencilScalar};
+
+/**
+ * @brief Function to select the widest kernels supported by the CPU (cpuid).
+ *
+ * The environment variable PDE_SIMD (scalar, avx2 or avx512) restricts the choice, e.g. to compare the versions.
+ */
+void initSimdKernels(void) {
+    const char *request = getenv("PDE_SIMD");
+    int allowAvx512 = !request || strcmp(request, "avx512") == 0;
+    int allowAvx2 = allowAvx512 || strcmp(request, "avx2") == 0;
+
+    __builtin_cpu_init();
+
+    if (allowAvx512 && __builtin_cpu_supports("avx512f")) {
+        kernels = avx512Kernels;
+    } else if (allowAvx2 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        kernels = avx2Kernels;
+    } else {
+        kernels = scalarKernels;
+    }
+}
@@ -1,12 +1,97 @@
-#include "utils.h"
-
-/**
- * @brief Function to return the time in milliseconds.
- *
- * @return double time.
- */
-double timestamp(void) {
-    struct timeval tp;
-    gettimeofday(&tp, NULL);
-    return ((double)(tp.tv_sec * 1000.0 + tp.tv_usec / 1000.0));
-}
+#include <string.h>
+
+#include "utils.h"
+
+/**
+ * @brief Function to return the time in milliseconds.
+ *
+ * CLOCK_MONOTONIC_RAW is read through the vDSO from the TSC on current kernels, so it has nanosecond resolution, does
+ * not go back and is not slewed by NTP.
+ *
+ * @return double time.
+ */
+double timestamp(void) {
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &tp);
+    return ((double)(tp.tv_sec * 1000.0 + tp.tv_nsec / 1000000.0));
+}
+
+/**
+ * @brief Function to create an empty timed region.
+ *
+ * @param name Region name (not copied).
+ * @return timerRegion
+ */
+timerRegion initTimerRegion(const char *name) {
+    timerRegion region = {name, NULL, 0, 0};
+
+    return region;
+}
+
+/**
+ * @brief Function to add a sample to a timed region, the sample array grows as needed.
+ *
+ * @param region Timed region.
+ * @param time Sample (ms).
+ */
+void addTimerSample(timerRegion *region, double time) {
+    if (region->nSamples == region->capacity) {
+        region->capacity = region->capacity ? 2 * region->capacity : 64;
+        region->samples = (double *)realloc(region->samples, region->capacity * sizeof(double));
+    }
+
+    region->samples[region->nSamples++] = time;
+}
+
+/**
+ * @brief Function to compare two doubles for qsort().
+ *
+ * @param a First value.
+ * @param b Second value.
+ * @return int
+ */
+int compareDouble(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Function to print a table with the min, median, p99 (nearest rank) and max of each timed region.
+ *
+ * @param regions Timed regions.
+ * @param nRegions Number of regions.
+ * @param output Output file.
+ */
+void printTimerRegions(const timerRegion *regions, int nRegions, FILE *output) {
+    fprintf(output, "#  amostras       mín (ms)   mediana (ms)       p99 (ms)       máx (ms)  Região\n");
+
+    for (int r = 0; r < nRegions; r++) {
+        int n = regions[r].nSamples;
+        double *sorted, median;
+
+        if (n == 0) {
+            continue;
+        }
+
+        sorted = (double *)malloc(n * sizeof(double));
+        memcpy(sorted, regions[r].samples, n * sizeof(double));
+        qsort(sorted, n, sizeof(double), compareDouble);
+        median = n % 2 ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+
+        fprintf(output, "# %9d %14.6f %14.6f %14.6f %14.6f  %s\n", n, sorted[0], median, sorted[(99 * n + 99) / 100 - 1], sorted[n - 1], regions[r].name);
+        free(sorted);
+    }
+}
+
+/**
+ * @brief Function to free the samples of a timed region.
+ *
+ * @param region Timed region.
+ */
+void freeTimerRegion(timerRegion *region) {
+    free(region->samples);
+
+    region->samples = NULL;
+    region->nSamples = region->capacity = 0;
+}